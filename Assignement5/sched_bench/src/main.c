@@ -0,0 +1,244 @@
+/*
+ * Scheduler backend benchmark
+ *
+ * Runs N synthetic periodic tasks, N = 2, 4, ... CONFIG_SCHED_BENCH_MAX_TASKS,
+ * under the scheduler backend selected at build time (overlay-dumb.conf,
+ * overlay-scalable.conf, overlay-multiq.conf). Task 0 mirrors the clock
+ * thread of the application (1 s period); the others cycle through
+ * harmonic periods of 1 to 100 ms with rate-monotonic priorities, and all
+ * are released together so the ready queue fills up at every hyperperiod.
+ * Each job busy-waits its share of CONFIG_SCHED_BENCH_UTIL_PCT.
+ *
+ * Reported per task count:
+ *  - switch: time from a job's end to the start of a job that was already
+ *    released, i.e. scheduler decision plus context switch (timing API)
+ *  - jitter: start time of a job minus its release time (kernel ticks)
+ *  - overhead: share of the run time spent neither in the task threads nor
+ *    idle, from the per-thread runtime statistics
+ *  - misses: jobs that started after their next release
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <timing/timing.h>
+#include <string.h>
+
+#define MAX_TASKS CONFIG_SCHED_BENCH_MAX_TASKS
+#define STACK_SIZE CONFIG_SCHED_BENCH_STACK_SIZE
+#define RELOGIO_PERIOD_MS 1000
+#define RELOGIO_EXEC_US 50
+#define EXEC_MIN_US 5
+
+/* Harmonic periods; the index is also the task priority */
+static const uint32_t periods_ms[] = { 1, 2, 5, 10, 20, 50, 100 };
+
+#define PRIO_BASE 1
+#define RELOGIO_PRIO (PRIO_BASE + ARRAY_SIZE(periods_ms))
+
+K_THREAD_STACK_ARRAY_DEFINE(task_stacks, MAX_TASKS, STACK_SIZE);
+static struct k_thread task_threads[MAX_TASKS];
+
+struct task {
+    uint32_t period_ticks;
+    uint32_t exec_us;
+    int64_t release;                /* Next release (ticks) */
+    uint32_t jobs;
+    uint32_t misses;
+};
+
+struct step_stats {
+    uint64_t switch_ns_sum;
+    uint32_t switch_ns_max;
+    uint32_t switches;
+    uint64_t jitter_ticks_sum;
+    uint32_t jitter_ticks_max;
+    uint32_t jobs;
+};
+
+static struct task tasks[MAX_TASKS];
+static struct step_stats stats;
+static volatile bool running;
+
+/* Last job end, shared by all tasks; only touched by the running task */
+static timing_t last_end;
+static int64_t last_end_ticks;
+static bool last_end_valid;
+
+static void task_code(void *argA, void *argB, void *argC)
+{
+    struct task *t = argA;
+    timing_t start;
+
+    while (running) {
+        k_sleep(K_TIMEOUT_ABS_TICKS(t->release));
+
+        start = timing_counter_get();
+        int64_t now = k_uptime_ticks();
+        uint32_t jitter = (uint32_t)(now - t->release);
+        unsigned int key = irq_lock();
+
+        /* Released before the previous job ended: the gap is pure
+         * scheduling and switching */
+        if (last_end_valid && t->release <= last_end_ticks) {
+            uint32_t ns = (uint32_t)timing_cycles_to_ns(timing_cycles_get(&last_end, &start));
+
+            stats.switch_ns_sum += ns;
+            stats.switch_ns_max = MAX(stats.switch_ns_max, ns);
+            stats.switches++;
+        }
+        stats.jitter_ticks_sum += jitter;
+        stats.jitter_ticks_max = MAX(stats.jitter_ticks_max, jitter);
+        if (jitter >= t->period_ticks) {
+            t->misses++;
+        }
+        irq_unlock(key);
+
+        k_busy_wait(t->exec_us);
+
+        t->release += t->period_ticks;
+        t->jobs++;
+
+        key = irq_lock();
+        stats.jobs++;
+
+        last_end = timing_counter_get();
+        last_end_ticks = k_uptime_ticks();
+        last_end_valid = true;
+        irq_unlock(key);
+    }
+}
+
+static k_tid_t idle_tid;
+
+/* The idle thread's name differs between kernel versions, its priority
+ * does not */
+static void find_idle(const struct k_thread *thread, void *user_data)
+{
+    if (k_thread_priority_get((k_tid_t)thread) == K_IDLE_PRIO) {
+        idle_tid = (k_tid_t)thread;
+    }
+}
+
+static uint64_t thread_cycles(k_tid_t tid)
+{
+    k_thread_runtime_stats_t rt;
+
+    if (k_thread_runtime_stats_get(tid, &rt) != 0) {
+        return 0;
+    }
+
+    return rt.execution_cycles;
+}
+
+/* CPU time of the first n tasks; a job's wall-clock span would also cover
+ * the higher-priority jobs preempting it */
+static uint64_t task_cycles(int n)
+{
+    uint64_t sum = 0;
+
+    for (int i = 0; i < n; i++) {
+        sum += thread_cycles(&task_threads[i]);
+    }
+
+    return sum;
+}
+
+static void run_step(int n)
+{
+    uint32_t util = CONFIG_SCHED_BENCH_UTIL_PCT;
+    uint32_t misses = 0;
+    uint64_t idle0, idle1, busy0, busy1, wall_ns, idle_ns, busy_ns;
+    uint32_t ovh_pm;
+    uint32_t t0, t1;
+    int64_t first;
+
+    memset(&stats, 0, sizeof(stats));
+    last_end_valid = false;
+    running = true;
+
+    /* Common first release, far enough out for all threads to be created */
+    first = k_uptime_ticks() + k_ms_to_ticks_ceil32(10);
+
+    for (int i = 0; i < n; i++) {
+        struct task *t = &tasks[i];
+        uint32_t period_ms;
+        int prio;
+
+        if (i == 0) {
+            period_ms = RELOGIO_PERIOD_MS;
+            t->exec_us = RELOGIO_EXEC_US;
+            prio = RELOGIO_PRIO;
+        } else {
+            int p = (i - 1) % ARRAY_SIZE(periods_ms);
+
+            period_ms = periods_ms[p];
+            t->exec_us = MAX(period_ms * USEC_PER_MSEC * util / 100 / (n - 1),
+                             EXEC_MIN_US);
+            prio = PRIO_BASE + p;
+        }
+        t->period_ticks = k_ms_to_ticks_ceil32(period_ms);
+        t->release = first;
+        t->jobs = 0;
+        t->misses = 0;
+
+        k_thread_create(&task_threads[i], task_stacks[i],
+                        K_THREAD_STACK_SIZEOF(task_stacks[i]), task_code,
+                        t, NULL, NULL, prio, 0, K_NO_WAIT);
+    }
+
+    k_sleep(K_TIMEOUT_ABS_TICKS(first));
+    idle0 = thread_cycles(idle_tid);
+    busy0 = task_cycles(n);
+    t0 = k_cycle_get_32();
+
+    k_msleep(CONFIG_SCHED_BENCH_STEP_MS);
+
+    t1 = k_cycle_get_32();
+    busy1 = task_cycles(n);
+    idle1 = thread_cycles(idle_tid);
+    running = false;
+    for (int i = 0; i < n; i++) {
+        k_thread_join(&task_threads[i], K_FOREVER);
+        misses += tasks[i].misses;
+    }
+
+    wall_ns = k_cyc_to_ns_floor64(t1 - t0);
+    idle_ns = k_cyc_to_ns_floor64(idle1 - idle0);
+    busy_ns = k_cyc_to_ns_floor64(busy1 - busy0);
+    ovh_pm = (uint32_t)((wall_ns - MIN(wall_ns, idle_ns + busy_ns)) * 1000 / wall_ns);
+
+    printk("%5d %8u %8u %9u %9u %7u.%u %7u\n\r", n,
+           stats.switches ? (uint32_t)(stats.switch_ns_sum / stats.switches) : 0,
+           stats.switch_ns_max,
+           stats.jobs ? (uint32_t)(k_ticks_to_us_floor64(stats.jitter_ticks_sum) / stats.jobs) : 0,
+           (uint32_t)k_ticks_to_us_floor64(stats.jitter_ticks_max),
+           ovh_pm / 10, ovh_pm % 10, misses);
+}
+
+void main(void)
+{
+    const char *backend =
+        IS_ENABLED(CONFIG_SCHED_MULTIQ) ? "multiq" :
+        IS_ENABLED(CONFIG_SCHED_SCALABLE) ? "scalable" : "dumb";
+
+    timing_init();
+    timing_start();
+    k_thread_foreach(find_idle, NULL);
+    if (idle_tid == NULL) {
+        printk("Scheduler bench: idle thread not found\n\r");
+        return;
+    }
+
+    /* main runs at priority 0, above all tasks, so the measurement
+     * windows start and end on time */
+
+    printk("Scheduler bench: %s backend, %d%% utilization, %d ms per step\n\r",
+           backend, CONFIG_SCHED_BENCH_UTIL_PCT, CONFIG_SCHED_BENCH_STEP_MS);
+    printk("tasks  sw avg ns  sw max ns  jit avg us  jit max us  ovh %%  misses\n\r");
+
+    for (int n = 2; n <= MAX_TASKS; n *= 2) {
+        run_step(n);
+    }
+
+    printk("Scheduler bench done\n\r");
+}
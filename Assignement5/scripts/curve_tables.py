@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+"""Shape tables of the fade curve generator (src/curve.c).
+
+Prints the C initializer of curve_tables[]: for each shape, its value at
+CURVE_SEGMENTS + 1 evenly spaced points of [0, 1], in Q15. Also prints,
+on stderr, the largest deviation of the linear interpolation from the
+exact shape, in Q15 units.
+
+    curve_tables.py > tables.txt
+"""
+
+import math
+import sys
+
+SEGMENTS = 128
+GAMMA = 2.2
+Q15 = 32767
+
+
+def ease_cubic(x):
+    return 4 * x ** 3 if x < 0.5 else 1 - (-2 * x + 2) ** 3 / 2
+
+
+SHAPES = [
+    ("CURVE_LINEAR", lambda x: x),
+    ("CURVE_GAMMA", lambda x: x ** GAMMA),
+    ("CURVE_EASE", ease_cubic),
+    ("CURVE_SINE", lambda x: (1 - math.cos(math.pi * x)) / 2),
+]
+
+
+def main():
+    for name, f in SHAPES:
+        table = [round(f(k / SEGMENTS) * Q15) for k in range(SEGMENTS + 1)]
+
+        err = 0.0
+        for i in range(SEGMENTS * 64):
+            x = i / (SEGMENTS * 64)
+            k, frac = divmod(i, 64)
+            y = table[k] + (table[k + 1] - table[k]) * frac / 64
+            err = max(err, abs(y - f(x) * Q15))
+        print("%-13s max interpolation error %.2f" % (name, err), file=sys.stderr)
+
+        print("    [%s] = {" % name)
+        for i in range(0, len(table), 8):
+            print("        " + " ".join("%5u," % v for v in table[i:i + 8]))
+        print("    },")
+
+
+if __name__ == "__main__":
+    main()
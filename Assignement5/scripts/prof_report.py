@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""Per-function profile from the PC-sampling profiler (src/prof.c).
+
+Input is either a console log holding a "dump prof" histogram
+("prof 0x<addr> <count>" lines, last dump wins) or, with --raw, a binary
+file of little-endian 32-bit PCs captured from the RTT profiler channel,
+e.g. with:
+
+    JLinkRTTLogger -Device NRF52840_XXAA -If SWD -Speed 4000 -RTTChannel 1 prof.bin
+
+Addresses are resolved against the symbol table of zephyr.elf using nm:
+by default the CMAKE_NM of the build directory holding the ELF, else
+arm-none-eabi-nm.
+A histogram bucket spanning several functions is split between them in
+proportion to the bytes each covers.
+
+    prof_report.py build/zephyr/zephyr.elf console.log
+    prof_report.py --raw build/zephyr/zephyr.elf prof.bin
+"""
+
+import argparse
+import bisect
+import collections
+import os
+import re
+import struct
+import subprocess
+import sys
+
+PC_ISR = 0
+DEFAULT_NM = "arm-none-eabi-nm"
+
+
+def build_nm(elf):
+    """nm of the toolchain that built "elf" (build/zephyr/zephyr.elf)."""
+    d = os.path.dirname(os.path.abspath(elf))
+    for cache in (os.path.join(d, "CMakeCache.txt"),
+                  os.path.join(os.path.dirname(d), "CMakeCache.txt")):
+        try:
+            with open(cache) as f:
+                for line in f:
+                    if line.startswith("CMAKE_NM:"):
+                        nm = line.split("=", 1)[1].strip()
+                        if os.path.exists(nm):
+                            return nm
+        except OSError:
+            continue
+    return DEFAULT_NM
+
+
+def load_symbols(elf, nm):
+    """Sorted list of (start, end, name) for the functions in "elf"."""
+    out = subprocess.run([nm, "-S", "-C", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    syms = {}
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) != 4 or parts[2] not in "TtWw":
+            continue
+        start = int(parts[0], 16) & ~1      # Drop the Thumb bit
+        size = int(parts[1], 16)
+        if size and start not in syms:
+            syms[start] = (start + size, parts[3])
+    return sorted((s, e, n) for s, (e, n) in syms.items())
+
+
+class Resolver:
+    def __init__(self, syms):
+        self.syms = syms
+        self.starts = [s for s, _, _ in syms]
+
+    def name(self, pc):
+        i = bisect.bisect_right(self.starts, pc) - 1
+        if i >= 0 and pc < self.syms[i][1]:
+            return self.syms[i][2]
+        return "[0x%08x]" % pc
+
+    def split(self, start, width):
+        """(name, share) of the functions overlapping [start, start+width)."""
+        end = start + width
+        i = max(bisect.bisect_right(self.starts, start) - 1, 0)
+        shares = []
+        covered = 0
+        while i < len(self.syms) and self.syms[i][0] < end:
+            s, e, n = self.syms[i]
+            overlap = min(e, end) - max(s, start)
+            if overlap > 0:
+                shares.append((n, overlap / width))
+                covered += overlap
+            i += 1
+        if covered < width:
+            shares.append(("[0x%08x]" % start, (width - covered) / width))
+        return shares
+
+
+def profile_raw(path, res):
+    counts = collections.Counter()
+    with open(path, "rb") as f:
+        data = f.read()
+    data = data[:len(data) - len(data) % 4]
+    for (pc,) in struct.iter_unpack("<I", data):
+        counts["[isr]" if pc == PC_ISR else res.name(pc & ~1)] += 1
+    return counts
+
+
+def profile_hist(path, res):
+    head_re = re.compile(r"prof: (\d+) samples, (\d+) in ISRs, (\d+) outside text.*bucket (\d+) bytes")
+    line_re = re.compile(r"prof 0x([0-9a-fA-F]+) (\d+)")
+    counts = None
+    width = 0
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = head_re.search(line)
+            if m:
+                counts = collections.Counter()
+                counts["[isr]"] = int(m.group(2))
+                counts["[outside text]"] = int(m.group(3))
+                width = int(m.group(4))
+                continue
+            m = line_re.search(line)
+            if m and counts is not None:
+                for name, share in res.split(int(m.group(1), 16), width):
+                    counts[name] += int(m.group(2)) * share
+    if counts is None:
+        sys.exit("no profiler dump found in %s" % path)
+    return counts
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("elf")
+    ap.add_argument("samples", help="console log, or raw RTT capture with --raw")
+    ap.add_argument("--raw", action="store_true", help="samples is a raw RTT capture")
+    ap.add_argument("--nm", help="nm of the toolchain (default: from the build's CMakeCache.txt)")
+    ap.add_argument("-n", "--top", type=int, default=30, help="functions to list")
+    args = ap.parse_args()
+
+    res = Resolver(load_symbols(args.elf, args.nm or build_nm(args.elf)))
+    counts = profile_raw(args.samples, res) if args.raw else profile_hist(args.samples, res)
+
+    total = sum(counts.values())
+    if total == 0:
+        sys.exit("no samples")
+    print("%10s %7s  %s" % ("samples", "%", "function"))
+    for name, n in counts.most_common(args.top):
+        if n:
+            print("%10.0f %6.2f%%  %s" % (n, 100.0 * n / total, name))
+    print("%10.0f total" % total)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+"""Decoder for the binary telemetry frames of src/telem.c.
+
+Reads COBS-framed telemetry from a serial port (configured raw at --baud)
+or a capture file ("-" for stdin) and prints one line per record. Frame
+format: see src/telem.h.
+
+Metric values are named from the "dump metrics" output of the same build
+(--layout, a console log holding it); without it they are printed by
+index. The layout hash of each snapshot is checked against it.
+
+At the end, or on Ctrl-C, it prints the frame counts and the number of
+bytes the same information takes as console text, using the firmware's
+printk formats.
+
+    telem_decode.py /dev/ttyUSB0 --layout console.log
+    telem_decode.py capture.bin --quiet
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import termios
+import tty
+
+TELEM_VERSION = 1
+TELEM_CLOCK, TELEM_DUTY, TELEM_BUTTON, TELEM_METRICS, TELEM_DROPPED = range(1, 6)
+TELEM_PRESS = 0xff
+
+GESTURES = ["short", "long", "double", "repeat"]
+
+
+def crc16_ccitt(seed, data):
+    """Zephyr's crc16_ccitt() (lib/os/crc16_sw.c)."""
+    for b in data:
+        e = (seed ^ b) & 0xff
+        f = (e ^ (e << 4)) & 0xff
+        seed = ((seed >> 8) ^ (f << 8) ^ (f << 3) ^ (f >> 4)) & 0xffff
+    return seed
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("bad COBS code")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xff and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def varint(buf, pos):
+    v = 0
+    shift = 0
+    while True:
+        b = buf[pos]
+        pos += 1
+        v |= (b & 0x7f) << shift
+        shift += 7
+        if not b & 0x80:
+            return v, pos
+
+
+def load_layout(path):
+    """(layout hash, [(name, kind, n_values)]) from a "dump metrics" log."""
+    layout = None
+    metrics = []
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = re.search(r"metrics layout ([0-9a-f]{4})", line)
+            if m:
+                layout = int(m.group(1), 16)
+                metrics = []
+                continue
+            m = re.match(r"\s+(\d+) (\S+)\s+(counter|gauge|histogram) (\d+)", line)
+            if m and layout is not None:
+                metrics.append((m.group(2), m.group(3), int(m.group(4))))
+    if layout is None:
+        sys.exit("%s: no \"dump metrics\" output" % path)
+    return layout, metrics
+
+
+class Decoder:
+    def __init__(self, layout, quiet):
+        self.layout = layout
+        self.quiet = quiet
+        self.frames = 0
+        self.bad = 0
+        self.lost_frames = 0
+        self.records = 0
+        self.dropped = 0
+        self.wire = 0
+        self.text = 0
+        self.seq = None
+
+    def out(self, ms, line):
+        if not self.quiet:
+            print("%10.3f %s" % (ms / 1000.0, line))
+
+    def frame(self, enc, partial=False):
+        """Decode one frame. A "partial" frame (cut by the start of the
+        capture) is not counted as bad if it does not check."""
+        try:
+            data = cobs_decode(enc)
+        except ValueError:
+            data = b""
+        if (len(data) < 8 or data[0] != TELEM_VERSION or
+                crc16_ccitt(0xffff, data[:-2]) != struct.unpack_from("<H", data, len(data) - 2)[0]):
+            if not partial:
+                self.bad += 1
+                self.wire += len(enc) + 1
+            return
+        self.wire += len(enc) + 1
+        version, seq, ms = struct.unpack_from("<BBI", data, 0)
+        if self.seq is not None:
+            self.lost_frames += (seq - self.seq - 1) & 0xff
+        self.seq = seq
+        self.frames += 1
+
+        body = data[:-2]
+        pos = 6
+        # Delta coding references, reset with each frame
+        state = {"epoch": 0, "metrics": []}
+        try:
+            while pos < len(body):
+                kind = body[pos]
+                dt, pos = varint(body, pos + 1)
+                ms += dt
+                pos = self.record(kind, body, pos, ms, state)
+                self.records += 1
+        except (IndexError, ValueError) as e:
+            print("frame %u: %s" % (seq, e), file=sys.stderr)
+
+    def record(self, kind, body, pos, ms, state):
+        if kind == TELEM_CLOCK:
+            z, pos = varint(body, pos)
+            state["epoch"] += (z >> 1) ^ -(z & 1)
+            epoch = state["epoch"]
+            s = epoch % 86400
+            self.out(ms, "clock %u (%02u:%02u:%02u)" % (epoch, s // 3600, s // 60 % 60, s % 60))
+            self.text += len("Thread Relogio activated\n\r")
+        elif kind == TELEM_DUTY:
+            pin = body[pos]
+            permille, pos = varint(body, pos + 1)
+            self.out(ms, "duty pin %u %u.%u %%" % (pin, permille // 10, permille % 10))
+            self.text += len("PWM DC value of pin %u set to %u.%u %%\n\r"
+                             % (pin, permille // 10, permille % 10))
+        elif kind == TELEM_BUTTON:
+            button, gesture = body[pos], body[pos + 1]
+            pos += 2
+            if gesture == TELEM_PRESS:
+                self.out(ms, "button %u press" % button)
+                self.text += len("But%u pressed at %d\n\r" % (button, 2 ** 31 - 1))
+            else:
+                name = GESTURES[gesture] if gesture < len(GESTURES) else str(gesture)
+                self.out(ms, "button %u %s" % (button, name))
+                self.text += len("But%u %s press\n\r" % (button, name))
+        elif kind == TELEM_METRICS:
+            pos = self.metrics(body, pos, ms, state["metrics"])
+        elif kind == TELEM_DROPPED:
+            n, pos = varint(body, pos)
+            self.dropped += n
+            self.out(ms, "dropped %u records" % n)
+        else:
+            raise ValueError("unknown record type %u" % kind)
+        return pos
+
+    def metrics(self, body, pos, ms, prev):
+        (layout,) = struct.unpack_from("<H", body, pos)
+        n, pos = varint(body, pos + 2)
+        bitmap = body[pos:pos + (n + 7) // 8]
+        pos += (n + 7) // 8
+        if not prev:
+            prev[:] = [0] * n
+        for i in range(n):
+            if bitmap[i // 8] & (1 << (i % 8)):
+                z, pos = varint(body, pos)
+                prev[i] = (prev[i] + ((z >> 1) ^ -(z & 1))) & 0xffffffff
+
+        if self.layout is None or layout != self.layout[0]:
+            if self.layout is not None:
+                print("metrics layout %04x, expected %04x" % (layout, self.layout[0]),
+                      file=sys.stderr)
+            self.out(ms, "metrics %04x %s" % (layout, " ".join(map(str, prev))))
+            return pos
+        i = 0
+        for name, kind, count in self.layout[1]:
+            line = "%-20s %s" % (name, " ".join(map(str, prev[i:i + count])))
+            i += count
+            self.out(ms, "metric " + line)
+            self.text += len(line) + 2
+        return pos
+
+    def summary(self):
+        print("%u frames (%u bad, %u lost), %u records (%u dropped), %u bytes"
+              % (self.frames, self.bad, self.lost_frames, self.records, self.dropped, self.wire))
+        if self.wire:
+            print("as console text: %u bytes, %.1fx" % (self.text, self.text / self.wire))
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer.fileno()
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attr = termios.tcgetattr(fd)
+        speed = getattr(termios, "B%u" % baud)
+        attr[4] = attr[5] = speed
+        termios.tcsetattr(fd, termios.TCSANOW, attr)
+    return fd
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("input", help="serial port, capture file or - for stdin")
+    ap.add_argument("--layout", help="console log with the \"dump metrics\" output")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--quiet", action="store_true", help="only print the summary")
+    args = ap.parse_args()
+
+    dec = Decoder(load_layout(args.layout) if args.layout else None, args.quiet)
+    fd = open_input(args.input, args.baud)
+    pending = b""
+    synced = False
+    try:
+        while True:
+            chunk = os.read(fd, 4096)
+            if not chunk:
+                break
+            pending += chunk
+            *frames, pending = pending.split(b"\0")
+            for f in frames:
+                # Bytes before the first delimiter may be a partial frame
+                if f:
+                    dec.frame(f, partial=not synced)
+                synced = True
+    except KeyboardInterrupt:
+        pass
+    dec.summary()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Run a time synchronization master and slave (native_posix builds with
+# overlay-tsync-native.conf) connected through their UART_1 pseudo-terminals,
+# and print the slave reports.
+#
+#   tsync_pty_test.sh <master zephyr.exe> <slave zephyr.exe> [seconds]
+set -e
+
+MASTER=$1
+SLAVE=$2
+SECONDS_RUN=${3:-60}
+TMP=$(mktemp -d)
+
+cleanup() {
+    kill "$MPID" "$SPID" "$BPID" 2>/dev/null || true
+    rm -rf "$TMP"
+}
+trap cleanup EXIT
+
+pty_of() {
+    for i in $(seq 50); do
+        PTY=$(sed -n 's/.*UART_1 connected to pseudotty: \(\/dev\/[^ ]*\).*/\1/p' "$1")
+        if [ -n "$PTY" ]; then
+            echo "$PTY"
+            return
+        fi
+        sleep 0.1
+    done
+    echo "no UART_1 pty in $1" >&2
+    exit 1
+}
+
+"$MASTER" > "$TMP/master.log" 2>&1 &
+MPID=$!
+"$SLAVE" > "$TMP/slave.log" 2>&1 &
+SPID=$!
+
+MPTY=$(pty_of "$TMP/master.log") || exit 1
+SPTY=$(pty_of "$TMP/slave.log") || exit 1
+
+socat "$MPTY,raw,echo=0" "$SPTY,raw,echo=0" &
+BPID=$!
+
+sleep "$SECONDS_RUN"
+grep "tsync:" "$TMP/slave.log"
@@ -0,0 +1,220 @@
+/*
+ * Time-of-day alarms
+ *
+ * The heap stores pointers to caller-owned alarm objects; each alarm keeps
+ * its heap index so it can be removed in O(log n) without a search.
+ * Expiries are kept in uptime (ms): the k_timer is armed with an absolute
+ * timeout, so the time to the next alarm is never accumulated from
+ * relative sleeps. When the clock is set, alarm_resync() recomputes every
+ * expiry from the stored second of day and rebuilds the heap.
+ */
+
+#include <zephyr.h>
+#include <spinlock.h>
+#include <errno.h>
+
+#include "alarm.h"
+#include "clock.h"
+
+static struct alarm *heap[CONFIG_APP_ALARM_MAX];
+static int heap_len;
+static struct k_spinlock alarm_lock;
+
+static void alarm_timer_expiry(struct k_timer *timer);
+static void alarm_work_handler(struct k_work *work);
+
+static K_TIMER_DEFINE(alarm_timer, alarm_timer_expiry, NULL);
+static K_WORK_DEFINE(alarm_work, alarm_work_handler);
+
+/* Heap helpers, called with alarm_lock held */
+
+static inline void heap_place(int idx, struct alarm *a)
+{
+    heap[idx] = a;
+    a->heap_idx = idx;
+}
+
+static void heap_sift_up(int idx)
+{
+    struct alarm *a = heap[idx];
+
+    while (idx > 0) {
+        int parent = (idx - 1) / 2;
+
+        if (heap[parent]->expiry <= a->expiry) {
+            break;
+        }
+        heap_place(idx, heap[parent]);
+        idx = parent;
+    }
+    heap_place(idx, a);
+}
+
+static void heap_sift_down(int idx)
+{
+    struct alarm *a = heap[idx];
+
+    for (;;) {
+        int child = 2 * idx + 1;
+
+        if (child >= heap_len) {
+            break;
+        }
+        if (child + 1 < heap_len && heap[child + 1]->expiry < heap[child]->expiry) {
+            child++;
+        }
+        if (a->expiry <= heap[child]->expiry) {
+            break;
+        }
+        heap_place(idx, heap[child]);
+        idx = child;
+    }
+    heap_place(idx, a);
+}
+
+static void heap_remove(struct alarm *a)
+{
+    int idx = a->heap_idx;
+    struct alarm *last = heap[--heap_len];
+
+    a->heap_idx = -1;
+    if (last == a) {
+        return;
+    }
+    heap_place(idx, last);
+    if (idx > 0 && heap[(idx - 1) / 2]->expiry > last->expiry) {
+        heap_sift_up(idx);
+    } else {
+        heap_sift_down(idx);
+    }
+}
+
+/* Arm the timer for the heap root. Called with alarm_lock held */
+static void timer_rearm(void)
+{
+    if (heap_len == 0) {
+        k_timer_stop(&alarm_timer);
+    } else {
+        k_timer_start(&alarm_timer, K_TIMEOUT_ABS_MS(heap[0]->expiry), K_NO_WAIT);
+    }
+}
+
+static void alarm_timer_expiry(struct k_timer *timer)
+{
+    k_work_submit(&alarm_work);
+}
+
+static void alarm_work_handler(struct k_work *work)
+{
+    alarm_process(k_uptime_get());
+}
+
+void alarm_init(struct alarm *alarm, alarm_cb_t cb, void *user_data)
+{
+    alarm->cb = cb;
+    alarm->user_data = user_data;
+    alarm->heap_idx = -1;
+}
+
+int alarm_start(struct alarm *alarm, uint32_t sod, uint32_t repeat_s)
+{
+    k_spinlock_key_t key;
+    bool was_root;
+    int ret = 0;
+
+    if (sod >= CLOCK_SEC_PER_DAY || alarm->cb == NULL) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&alarm_lock);
+    was_root = (alarm->heap_idx == 0);
+    if (alarm->heap_idx >= 0) {
+        heap_remove(alarm);
+    }
+    if (heap_len == CONFIG_APP_ALARM_MAX) {
+        ret = -ENOMEM;
+    } else {
+        alarm->sod = sod;
+        alarm->repeat_s = repeat_s;
+        alarm->expiry = clock_next_uptime(sod);
+        heap_place(heap_len++, alarm);
+        heap_sift_up(alarm->heap_idx);
+    }
+    if (was_root || (ret == 0 && heap[0] == alarm)) {
+        timer_rearm();
+    }
+    k_spin_unlock(&alarm_lock, key);
+
+    return ret;
+}
+
+int alarm_cancel(struct alarm *alarm)
+{
+    k_spinlock_key_t key = k_spin_lock(&alarm_lock);
+    bool was_root;
+
+    if (alarm->heap_idx < 0) {
+        k_spin_unlock(&alarm_lock, key);
+        return -EALREADY;
+    }
+    was_root = (alarm->heap_idx == 0);
+    heap_remove(alarm);
+    if (was_root) {
+        timer_rearm();
+    }
+    k_spin_unlock(&alarm_lock, key);
+
+    return 0;
+}
+
+int alarm_count(void)
+{
+    return heap_len;
+}
+
+void alarm_resync(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&alarm_lock);
+
+    for (int i = 0; i < heap_len; i++) {
+        heap[i]->expiry = clock_next_uptime(heap[i]->sod);
+    }
+    /* Floyd's heap construction, O(n) */
+    for (int i = heap_len / 2 - 1; i >= 0; i--) {
+        heap_sift_down(i);
+    }
+    timer_rearm();
+    k_spin_unlock(&alarm_lock, key);
+}
+
+int alarm_process(int64_t now)
+{
+    int fired = 0;
+
+    for (;;) {
+        k_spinlock_key_t key = k_spin_lock(&alarm_lock);
+        struct alarm *a;
+
+        if (heap_len == 0 || heap[0]->expiry > now) {
+            timer_rearm();
+            k_spin_unlock(&alarm_lock, key);
+            break;
+        }
+
+        a = heap[0];
+        heap_remove(a);
+        if (a->repeat_s > 0) {
+            a->sod = (a->sod + a->repeat_s) % CLOCK_SEC_PER_DAY;
+            a->expiry += (int64_t)a->repeat_s * MSEC_PER_SEC;
+            heap_place(heap_len++, a);
+            heap_sift_up(a->heap_idx);
+        }
+        k_spin_unlock(&alarm_lock, key);
+
+        /* Callbacks run unlocked, they may start or cancel alarms */
+        a->cb(a);
+        fired++;
+    }
+
+    return fired;
+}
@@ -0,0 +1,56 @@
+/*
+ * Time-of-day alarms
+ *
+ * Pending alarms are kept in a binary min-heap ordered by expiry, and a
+ * single k_timer is always armed for the earliest one: insert and cancel
+ * are O(log n) and nothing runs between expiries. Callbacks are delivered
+ * from the system work queue.
+ */
+
+#ifndef ALARM_H
+#define ALARM_H
+
+#include <zephyr.h>
+
+struct alarm;
+
+typedef void (*alarm_cb_t)(struct alarm *alarm);
+
+/* Alarm object, allocated by the caller. Fields are private */
+struct alarm {
+    alarm_cb_t cb;
+    void *user_data;
+    uint32_t sod;           /* Next expiry, second of day */
+    uint32_t repeat_s;      /* Repeat interval (s), 0 for one-shot */
+    int64_t expiry;         /* Next expiry, uptime (ms) */
+    int heap_idx;           /* Position in the heap, -1 when not pending */
+};
+
+/* Prepare an alarm object before first use */
+void alarm_init(struct alarm *alarm, alarm_cb_t cb, void *user_data);
+
+/* Schedule "alarm" at second-of-day "sod", then every "repeat_s" seconds
+ * (0 for one-shot). An alarm already pending is rescheduled.
+ * Returns 0, -EINVAL on bad arguments or -ENOMEM if the heap is full. */
+int alarm_start(struct alarm *alarm, uint32_t sod, uint32_t repeat_s);
+
+/* Cancel a pending alarm. Returns 0 or -EALREADY if it was not pending */
+int alarm_cancel(struct alarm *alarm);
+
+/* Number of pending alarms */
+int alarm_count(void);
+
+/* Recompute all expiries after the clock has been set */
+void alarm_resync(void);
+
+/* Fire all alarms expired at uptime "now" (ms) and re-arm the timer.
+ * Called from the alarm work item; exposed for the benchmark.
+ * Returns the number of callbacks invoked. */
+int alarm_process(int64_t now);
+
+#if defined(CONFIG_APP_ALARM_BENCH)
+/* Measure insert, cancel and fire cost as the alarm count grows */
+void alarm_bench_run(void);
+#endif
+
+#endif /* ALARM_H */
@@ -0,0 +1,85 @@
+/*
+ * Alarm engine benchmark
+ *
+ * For a growing number of pending alarms, measures the average cost of
+ * alarm_start() (insert), alarm_cancel() and of firing one alarm through
+ * alarm_process(). Expiries are spread pseudo-randomly over the day so the
+ * heap sees a realistic mix of positions. Results are printed in ns.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <timing/timing.h>
+
+#include "alarm.h"
+#include "clock.h"
+
+static struct alarm bench_alarms[CONFIG_APP_ALARM_MAX];
+static uint32_t bench_fired;
+
+static void bench_cb(struct alarm *alarm)
+{
+    bench_fired++;
+}
+
+/* Small LCG: deterministic expiry pattern across runs */
+static uint32_t bench_rand(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static uint64_t bench_ns(timing_t *start, timing_t *end, int n)
+{
+    return timing_cycles_to_ns(timing_cycles_get(start, end)) / n;
+}
+
+static void bench_one(int n)
+{
+    timing_t t0, t1;
+    uint32_t seed = 12345;
+    uint64_t insert_ns, cancel_ns, fire_ns;
+    int half = n / 2;
+
+    for (int i = 0; i < n; i++) {
+        alarm_init(&bench_alarms[i], bench_cb, NULL);
+    }
+
+    /* Insert n alarms */
+    t0 = timing_counter_get();
+    for (int i = 0; i < n; i++) {
+        alarm_start(&bench_alarms[i], bench_rand(&seed) % CLOCK_SEC_PER_DAY, 0);
+    }
+    t1 = timing_counter_get();
+    insert_ns = bench_ns(&t0, &t1, n);
+
+    /* Cancel every other alarm, i.e. from random heap positions */
+    t0 = timing_counter_get();
+    for (int i = 0; i < n; i += 2) {
+        alarm_cancel(&bench_alarms[i]);
+    }
+    t1 = timing_counter_get();
+    cancel_ns = bench_ns(&t0, &t1, (n + 1) / 2);
+
+    /* Fire the remaining ones: every expiry is at most one day away */
+    bench_fired = 0;
+    t0 = timing_counter_get();
+    alarm_process(k_uptime_get() + (int64_t)CLOCK_SEC_PER_DAY * MSEC_PER_SEC);
+    t1 = timing_counter_get();
+    fire_ns = bench_fired ? bench_ns(&t0, &t1, bench_fired) : 0;
+
+    printk("alarm bench n=%4d: insert %llu ns, cancel %llu ns, fire %llu ns (%u/%d fired)\n\r",
+           n, insert_ns, cancel_ns, fire_ns, bench_fired, half);
+}
+
+void alarm_bench_run(void)
+{
+    timing_init();
+    timing_start();
+
+    for (int n = 8; n <= CONFIG_APP_ALARM_MAX; n *= 2) {
+        bench_one(n);
+    }
+
+    timing_stop();
+}
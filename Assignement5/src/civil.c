@@ -0,0 +1,105 @@
+/*
+ * Epoch seconds <-> civil date and time
+ *
+ * Day counts use the days-from-civil / civil-from-days algorithms of
+ * H. Hinnant: years are shifted to start on March 1st, so the leap day is
+ * the last day of the (shifted) year and month lengths follow the linear
+ * formula (153 * m + 2) / 5. A 400-year era holds exactly 146097 days.
+ * All values stay non-negative for 1970..2106, so unsigned 32-bit
+ * arithmetic (single-cycle multiply, hardware divide) suffices.
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+
+#include "civil.h"
+
+#define DAYS_PER_ERA 146097u
+#define DAYS_0000_03_01_TO_1970 719468u    /* Days from 0000-03-01 to 1970-01-01 */
+
+uint32_t civil_days_from_date(uint32_t year, uint32_t month, uint32_t mday)
+{
+    uint32_t y = year - (month <= 2);
+    uint32_t era = y / 400;
+    uint32_t yoe = y - era * 400;                               /* [0, 399] */
+    uint32_t mp = (month + 9) % 12;                             /* March = 0 */
+    uint32_t doy = (153 * mp + 2) / 5 + mday - 1;               /* [0, 365] */
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;       /* [0, 146096] */
+
+    return era * DAYS_PER_ERA + doe - DAYS_0000_03_01_TO_1970;
+}
+
+static void date_from_days(uint32_t days, struct civil_time *ct)
+{
+    uint32_t z = days + DAYS_0000_03_01_TO_1970;
+    uint32_t era = z / DAYS_PER_ERA;
+    uint32_t doe = z - era * DAYS_PER_ERA;                               /* [0, 146096] */
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365; /* [0, 399] */
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);              /* [0, 365] */
+    uint32_t mp = (5 * doy + 2) / 153;                                   /* [0, 11] */
+    uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+
+    ct->mday = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    ct->month = (uint8_t)month;
+    ct->year = (uint16_t)(yoe + era * 400 + (month <= 2));
+    ct->wday = (uint8_t)((days + 4) % 7);   /* 1970-01-01 was a Thursday */
+}
+
+static inline void time_from_sod(uint32_t sod, struct civil_time *ct)
+{
+    ct->hour = (uint8_t)(sod / 3600);
+    ct->min = (uint8_t)(sod / 60 % 60);
+    ct->sec = (uint8_t)(sod % 60);
+}
+
+void civil_from_epoch(uint32_t epoch, struct civil_time *ct)
+{
+    uint32_t days = epoch / CIVIL_SEC_PER_DAY;
+
+    date_from_days(days, ct);
+    time_from_sod(epoch - days * CIVIL_SEC_PER_DAY, ct);
+}
+
+int civil_to_epoch(const struct civil_time *ct, uint32_t *epoch)
+{
+    static const uint8_t mdays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+    if (ct->year < CIVIL_YEAR_MIN || ct->year > CIVIL_YEAR_MAX ||
+        ct->month < 1 || ct->month > 12 || ct->mday < 1 ||
+        ct->mday > mdays[ct->month - 1] + (ct->month == 2 && civil_is_leap(ct->year)) ||
+        ct->hour > 23 || ct->min > 59 || ct->sec > 59) {
+        return -EINVAL;
+    }
+
+    uint64_t e = (uint64_t)civil_days_from_date(ct->year, ct->month, ct->mday) *
+                 CIVIL_SEC_PER_DAY + ct->hour * 3600u + ct->min * 60u + ct->sec;
+
+    /* 2106-02-07 06:28:15 is the last representable second */
+    if (e > UINT32_MAX) {
+        return -EINVAL;
+    }
+    *epoch = (uint32_t)e;
+
+    return 0;
+}
+
+void civil_from_epoch_bulk(const uint32_t *epoch, struct civil_time *ct, size_t n)
+{
+    uint32_t day_start = 0;         /* Epoch of midnight of the cached date */
+    bool cached = false;
+    struct civil_time date;
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t t = epoch[i];
+
+        if (!cached || t - day_start >= CIVIL_SEC_PER_DAY) {
+            uint32_t days = t / CIVIL_SEC_PER_DAY;
+
+            date_from_days(days, &date);
+            day_start = days * CIVIL_SEC_PER_DAY;
+            cached = true;
+        }
+        ct[i] = date;
+        time_from_sod(t - day_start, &ct[i]);
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * Epoch seconds <-> civil (proleptic Gregorian, UTC) date and time
+ *
+ * Epoch seconds count from 1970-01-01 00:00:00 and are unsigned 32-bit,
+ * which covers 1970 to 2106-02-07 06:28:15. All conversions are constant time: no loops
+ * over years or months, and only 32-bit arithmetic.
+ */
+
+#ifndef CIVIL_H
+#define CIVIL_H
+
+#include <zephyr/types.h>
+#include <stddef.h>
+
+#define CIVIL_SEC_PER_DAY 86400u
+#define CIVIL_YEAR_MIN 1970
+#define CIVIL_YEAR_MAX 2106
+
+struct civil_time {
+    uint16_t year;
+    uint8_t month;      /* 1..12 */
+    uint8_t mday;       /* 1..31 */
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+    uint8_t wday;       /* 0 = Sunday */
+};
+
+/* Days since 1970-01-01 of a civil date (not validated) */
+uint32_t civil_days_from_date(uint32_t year, uint32_t month, uint32_t mday);
+
+/* Civil date and time of "epoch" */
+void civil_from_epoch(uint32_t epoch, struct civil_time *ct);
+
+/* Epoch seconds of "ct" (wday is ignored). Returns 0 or -EINVAL if a field
+ * is out of range */
+int civil_to_epoch(const struct civil_time *ct, uint32_t *epoch);
+
+/* Convert "n" timestamps. The date is only recomputed when the day
+ * changes, which makes chronological logs cheap to convert */
+void civil_from_epoch_bulk(const uint32_t *epoch, struct civil_time *ct, size_t n);
+
+#if defined(CONFIG_APP_CIVIL_BENCH)
+/* Measure single and bulk conversion cost against a loop-based reference */
+void civil_bench_run(void);
+#endif
+
+/* 1 if "year" is a leap year, else 0 */
+static inline uint32_t civil_is_leap(uint32_t year)
+{
+    return (year % 4 == 0) & ((year % 100 != 0) | (year % 400 == 0));
+}
+
+#endif /* CIVIL_H */
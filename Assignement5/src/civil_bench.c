@@ -0,0 +1,121 @@
+/*
+ * Calendar conversion benchmark
+ *
+ * Converts a synthetic event log (increasing timestamps with gaps of up to
+ * 10 minutes, as written by a logger) and prints the average cost per
+ * timestamp in ns of:
+ *  - a loop-based reference (walk years, then months)
+ *  - civil_from_epoch() one at a time
+ *  - civil_from_epoch_bulk()
+ *  - civil_to_epoch()
+ * Every result is checked against the reference.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <timing/timing.h>
+#include <string.h>
+
+#include "civil.h"
+
+#define BENCH_EVENTS 4096
+#define BENCH_CHUNK 64
+#define BENCH_START 1640995200u     /* 2022-01-01 00:00:00 */
+#define BENCH_MAX_GAP_S 600
+
+static uint32_t epochs[BENCH_CHUNK];
+static struct civil_time ref[BENCH_CHUNK];
+static struct civil_time out[BENCH_CHUNK];
+
+/* Reference: the textbook conversion with loops */
+static void ref_from_epoch(uint32_t epoch, struct civil_time *ct)
+{
+    static const uint8_t mdays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    uint32_t days = epoch / CIVIL_SEC_PER_DAY;
+    uint32_t sod = epoch % CIVIL_SEC_PER_DAY;
+    uint32_t year = 1970, month = 0;
+
+    ct->wday = (uint8_t)((days + 4) % 7);
+    while (days >= 365 + civil_is_leap(year)) {
+        days -= 365 + civil_is_leap(year);
+        year++;
+    }
+    while (days >= (uint32_t)mdays[month] + (month == 1 && civil_is_leap(year))) {
+        days -= mdays[month] + (month == 1 && civil_is_leap(year));
+        month++;
+    }
+    ct->year = (uint16_t)year;
+    ct->month = (uint8_t)(month + 1);
+    ct->mday = (uint8_t)(days + 1);
+    ct->hour = (uint8_t)(sod / 3600);
+    ct->min = (uint8_t)(sod / 60 % 60);
+    ct->sec = (uint8_t)(sod % 60);
+}
+
+static uint32_t bench_rand(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static uint64_t cycles(timing_t *start, timing_t *end)
+{
+    return timing_cycles_get(start, end);
+}
+
+void civil_bench_run(void)
+{
+    uint64_t c_ref = 0, c_one = 0, c_bulk = 0, c_to = 0;
+    uint32_t seed = 12345, t = BENCH_START, back;
+    uint32_t errors = 0;
+    timing_t t0, t1;
+
+    timing_init();
+    timing_start();
+
+    for (int done = 0; done < BENCH_EVENTS; done += BENCH_CHUNK) {
+        for (int i = 0; i < BENCH_CHUNK; i++) {
+            t += bench_rand(&seed) % BENCH_MAX_GAP_S;
+            epochs[i] = t;
+        }
+
+        t0 = timing_counter_get();
+        for (int i = 0; i < BENCH_CHUNK; i++) {
+            ref_from_epoch(epochs[i], &ref[i]);
+        }
+        t1 = timing_counter_get();
+        c_ref += cycles(&t0, &t1);
+
+        t0 = timing_counter_get();
+        for (int i = 0; i < BENCH_CHUNK; i++) {
+            civil_from_epoch(epochs[i], &out[i]);
+        }
+        t1 = timing_counter_get();
+        c_one += cycles(&t0, &t1);
+        errors += memcmp(ref, out, sizeof(out)) != 0;
+
+        t0 = timing_counter_get();
+        civil_from_epoch_bulk(epochs, out, BENCH_CHUNK);
+        t1 = timing_counter_get();
+        c_bulk += cycles(&t0, &t1);
+        errors += memcmp(ref, out, sizeof(out)) != 0;
+
+        t0 = timing_counter_get();
+        for (int i = 0; i < BENCH_CHUNK; i++) {
+            civil_to_epoch(&out[i], &back);
+        }
+        t1 = timing_counter_get();
+        c_to += cycles(&t0, &t1);
+        errors += back != epochs[BENCH_CHUNK - 1];
+    }
+
+    timing_stop();
+
+    printk("Calendar conversion (%d events, %u to %u), ns per event:\n\r",
+           BENCH_EVENTS, BENCH_START, t);
+    printk("  reference (loops) %6u\n\r", (uint32_t)(timing_cycles_to_ns(c_ref) / BENCH_EVENTS));
+    printk("  from epoch        %6u\n\r", (uint32_t)(timing_cycles_to_ns(c_one) / BENCH_EVENTS));
+    printk("  from epoch, bulk  %6u\n\r", (uint32_t)(timing_cycles_to_ns(c_bulk) / BENCH_EVENTS));
+    printk("  to epoch          %6u\n\r", (uint32_t)(timing_cycles_to_ns(c_to) / BENCH_EVENTS));
+    printk("  mismatching chunks: %u\n\r", errors);
+}
@@ -0,0 +1,300 @@
+/*
+ * Wall clock kept by the relogio thread or timer
+ *
+ * The time is a single epoch-seconds counter, so a tick is one increment
+ * and date rollovers need no carry chain; the calendar view is computed on
+ * read (civil.c). The uptime of the last tick is kept too, so a time of day
+ * can be mapped onto the uptime time base (used to arm timers).
+ *
+ * The ticks follow a schedule kept here in uptime nanoseconds: the tick
+ * scheduler (relogio thread, work item or timer) sleeps until
+ * clock_next_due(). The period is one second, lengthened or shortened by
+ * the discipline of clock_adjust(): a frequency correction, plus a phase
+ * correction slewed in at most APP_CLOCK_MAX_SLEW_PPM per period, so the
+ * time never jumps. Between ticks clock_now_ns() interpolates at the rate
+ * of the current period.
+ *
+ * Writers (the tick, possibly in ISR context, and clock_set) serialize on a
+ * spinlock. Readers never lock: the state is published under a sequence
+ * count that is odd while an update is in progress, and a reader retries
+ * if the count was odd or changed while it copied the state.
+ */
+
+#include <zephyr.h>
+#include <spinlock.h>
+#include <sys/atomic.h>
+#include <errno.h>
+
+#include "clock.h"
+#include "civil.h"
+#include "alarm.h"
+#include "sim.h"
+#include "hot.h"
+#include "evt_log.h"
+
+struct clock_state {
+    uint32_t epoch;             /* Seconds since 1970-01-01 00:00:00 */
+    int64_t tick_uptime;        /* Uptime (ms) of the last tick */
+    int64_t due_ns;             /* Uptime (ns) the last tick was due at */
+    uint32_t period_ns;         /* From due_ns to the next tick */
+};
+
+static struct clock_state cur = { .period_ns = NSEC_PER_SEC };
+static atomic_t clock_seq;
+static struct k_spinlock clock_lock;    /* Serializes writers */
+static struct k_poll_signal tick_sig = K_POLL_SIGNAL_INITIALIZER(tick_sig);
+
+/* Tick schedule and discipline, under clock_lock */
+static bool sched_started;
+static int64_t next_due_ns;     /* Uptime (ns) the next tick is due at */
+static int32_t freq_ppb;        /* Period correction (ns per second) */
+static int64_t slew_ns;         /* Phase correction not applied yet */
+
+#define MAX_SLEW_NS (CONFIG_APP_CLOCK_MAX_SLEW_PPM * 1000)
+
+static inline int64_t uptime_ns(void)
+{
+    return (int64_t)k_ticks_to_ns_floor64(k_uptime_ticks());
+}
+
+static inline void write_begin(void)
+{
+    atomic_inc(&clock_seq);
+    compiler_barrier();
+}
+
+static inline void write_end(void)
+{
+    compiler_barrier();
+    atomic_inc(&clock_seq);
+}
+
+static void clock_read(struct clock_state *st)
+{
+    atomic_val_t seq;
+
+    do {
+        seq = atomic_get(&clock_seq);
+        compiler_barrier();
+        *st = cur;
+        compiler_barrier();
+    } while ((seq & 1) || seq != atomic_get(&clock_seq));
+}
+
+APP_HOT void clock_tick(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&clock_lock);
+    struct clock_state st = cur;
+    uint32_t sod;
+
+    st.tick_uptime = k_uptime_get();
+    st.due_ns = next_due_ns;
+    st.epoch++;
+    write_begin();
+    cur = st;
+    write_end();
+    k_spin_unlock(&clock_lock, key);
+
+    sod = st.epoch % CLOCK_SEC_PER_DAY;
+
+    /* Only threads actually polling the signal are woken */
+    k_poll_signal_raise(&tick_sig, (int)sod);
+
+    if (IS_ENABLED(CONFIG_APP_SIM)) {
+        sim_record_clock(sod / 3600, sod / 60 % 60, sod % 60);
+    }
+}
+
+void clock_get(int *h, int *m, int *s)
+{
+    uint32_t sod = clock_get_sod();
+
+    *h = sod / 3600;
+    *m = sod / 60 % 60;
+    *s = sod % 60;
+}
+
+uint32_t clock_get_epoch(void)
+{
+    struct clock_state st;
+
+    clock_read(&st);
+
+    return st.epoch;
+}
+
+void clock_get_civil(struct civil_time *ct)
+{
+    civil_from_epoch(clock_get_epoch(), ct);
+}
+
+uint64_t clock_now_ns(void)
+{
+    struct clock_state st;
+    int64_t elapsed;
+
+    clock_read(&st);
+    /* Held at the next second while its tick is late, so it never goes back */
+    elapsed = CLAMP(uptime_ns() - st.due_ns, 0, (int64_t)st.period_ns);
+
+    return (uint64_t)st.epoch * NSEC_PER_SEC +
+           (uint64_t)(elapsed * NSEC_PER_SEC / st.period_ns);
+}
+
+int64_t clock_next_due(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&clock_lock);
+    int64_t step = CLAMP(slew_ns, -MAX_SLEW_NS, MAX_SLEW_NS);
+    int64_t period = NSEC_PER_SEC + freq_ppb + step;
+    int64_t due;
+
+#if defined(CONFIG_APP_TSYNC_TEST_DRIFT_PPB)
+    /* Simulated oscillator error: a fast clock has short seconds */
+    period -= CONFIG_APP_TSYNC_TEST_DRIFT_PPB;
+#endif
+    slew_ns -= step;
+
+    if (!sched_started) {
+        sched_started = true;
+        next_due_ns = uptime_ns();
+        write_begin();
+        cur.due_ns = next_due_ns;
+        write_end();
+    }
+    next_due_ns += period;
+    write_begin();
+    cur.period_ns = (uint32_t)period;
+    write_end();
+    due = next_due_ns;
+    k_spin_unlock(&clock_lock, key);
+
+    return (int64_t)k_ns_to_ticks_ceil64(due);
+}
+
+void clock_adjust(int64_t offset_ns, int32_t freq)
+{
+    k_spinlock_key_t key = k_spin_lock(&clock_lock);
+
+    slew_ns = offset_ns;
+    freq_ppb = freq;
+    k_spin_unlock(&clock_lock, key);
+}
+
+void clock_step_ns(int64_t offset_ns)
+{
+    k_spinlock_key_t key = k_spin_lock(&clock_lock);
+    int64_t secs = offset_ns / NSEC_PER_SEC;
+    int64_t rem = offset_ns % NSEC_PER_SEC;
+
+    /* Whole seconds on the count, the rest by shifting the schedule */
+    if (rem < 0) {
+        rem += NSEC_PER_SEC;
+        secs--;
+    }
+    write_begin();
+    cur.epoch -= (uint32_t)secs;
+    cur.due_ns += rem;
+    write_end();
+    next_due_ns += rem;
+    slew_ns = 0;
+    k_spin_unlock(&clock_lock, key);
+
+    if (IS_ENABLED(CONFIG_APP_ALARM)) {
+        alarm_resync();
+    }
+}
+
+struct k_poll_signal *clock_tick_signal(void)
+{
+    return &tick_sig;
+}
+
+/* Replace the time by "epoch" or, if "keep_date", only its time of day */
+static void clock_store(uint32_t epoch, bool keep_date)
+{
+    k_spinlock_key_t key = k_spin_lock(&clock_lock);
+
+    if (keep_date) {
+        epoch += cur.epoch - cur.epoch % CLOCK_SEC_PER_DAY;
+    }
+    write_begin();
+    cur.epoch = epoch;
+    cur.tick_uptime = k_uptime_get();
+    write_end();
+    k_spin_unlock(&clock_lock, key);
+
+    if (IS_ENABLED(CONFIG_APP_EVT_LOG)) {
+        evt_log(EVT_CLOCK_SET, (uint16_t)(epoch % CLOCK_SEC_PER_DAY / 60));
+    }
+
+    /* Alarm deadlines are kept in uptime, they must follow the new time */
+    if (IS_ENABLED(CONFIG_APP_ALARM)) {
+        alarm_resync();
+    }
+}
+
+int clock_set(int h, int m, int s)
+{
+    if (h < 0 || h > 23 || m < 0 || m > 59 || s < 0 || s > 59) {
+        return -EINVAL;
+    }
+
+    clock_store((uint32_t)(h * 3600 + m * 60 + s), true);
+
+    return 0;
+}
+
+int clock_set_date(int year, int month, int mday)
+{
+    struct civil_time ct = {
+        .year = (uint16_t)year,
+        .month = (uint8_t)month,
+        .mday = (uint8_t)mday,
+    };
+    uint32_t epoch, sod;
+    int ret;
+
+    if (year < CIVIL_YEAR_MIN || year > CIVIL_YEAR_MAX || month < 1 || mday < 1) {
+        return -EINVAL;
+    }
+    ret = civil_to_epoch(&ct, &epoch);
+    if (ret != 0) {
+        return ret;
+    }
+
+    /* Keep the time of day; the last day of 2106 may not fit */
+    sod = clock_get_sod();
+    if (epoch > UINT32_MAX - sod) {
+        return -EINVAL;
+    }
+    clock_store(epoch + sod, false);
+
+    return 0;
+}
+
+void clock_set_epoch(uint32_t epoch)
+{
+    clock_store(epoch, false);
+}
+
+uint32_t clock_get_sod(void)
+{
+    return clock_get_epoch() % CLOCK_SEC_PER_DAY;
+}
+
+int64_t clock_next_uptime(uint32_t sod)
+{
+    struct clock_state st;
+
+    clock_read(&st);
+
+    uint32_t now = st.epoch % CLOCK_SEC_PER_DAY;
+    int64_t base = st.tick_uptime;
+    uint32_t delta = (sod + CLOCK_SEC_PER_DAY - now) % CLOCK_SEC_PER_DAY;
+
+    if (delta == 0) {
+        delta = CLOCK_SEC_PER_DAY;
+    }
+
+    return base + (int64_t)delta * MSEC_PER_SEC;
+}
@@ -0,0 +1,69 @@
+/*
+ * Wall clock kept by the relogio thread or timer
+ *
+ * Kept as epoch seconds (UTC, see civil.h); starts at 1970-01-01 00:00:00.
+ * All readers are lock-free and may run in any context.
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <zephyr.h>
+
+#include "civil.h"
+
+#define CLOCK_SEC_PER_DAY 86400
+
+/* Advance the clock by one second. Called by the relogio thread, work item
+ * or timer expiry function (ISR) when clock_next_due() is reached */
+void clock_tick(void);
+
+/* Advance the tick schedule by one period and return the uptime, in kernel
+ * ticks, at which the next clock_tick() is due. The first call starts the
+ * schedule at the current uptime */
+int64_t clock_next_due(void);
+
+/* Current time in nanoseconds since the epoch, interpolated between ticks */
+uint64_t clock_now_ns(void);
+
+/* Discipline the clock, which is "offset_ns" ahead of the reference and
+ * runs "freq_ppb" fast: the following periods are lengthened by freq_ppb,
+ * and by the offset, slewed in at no more than APP_CLOCK_MAX_SLEW_PPM.
+ * Replaces the previous correction */
+void clock_adjust(int64_t offset_ns, int32_t freq_ppb);
+
+/* Step the clock back by "offset_ns" at once. For the initial acquisition
+ * only: the time may stand still for up to one second afterwards */
+void clock_step_ns(int64_t offset_ns);
+
+/* Read the current time of day */
+void clock_get(int *horas, int *min, int *seg);
+
+/* Set the time of day, keeping the date. Returns 0 or -EINVAL if out of range */
+int clock_set(int horas, int min, int seg);
+
+/* Set the date, keeping the time of day. Returns 0 or -EINVAL if not a
+ * valid date in the supported range */
+int clock_set_date(int year, int month, int mday);
+
+/* Current time in epoch seconds */
+uint32_t clock_get_epoch(void);
+
+/* Set the time in epoch seconds */
+void clock_set_epoch(uint32_t epoch);
+
+/* Current date and time */
+void clock_get_civil(struct civil_time *ct);
+
+/* Current time of day in seconds since midnight */
+uint32_t clock_get_sod(void);
+
+/* Uptime (ms) at which the clock is due to reach second-of-day "sod" next
+ * (strictly in the future, at most one day ahead) */
+int64_t clock_next_uptime(uint32_t sod);
+
+/* Poll signal raised on every tick, with the new second-of-day as result.
+ * Optional consumers k_poll() it; nothing is woken if nobody waits */
+struct k_poll_signal *clock_tick_signal(void);
+
+#endif /* CLOCK_H */
@@ -0,0 +1,92 @@
+/*
+ * Clock-set UI on three buttons
+ *
+ * The time being edited is a private copy taken when set mode is entered;
+ * the clock keeps running and is only written on the final confirmation.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+
+#include "clock_ui.h"
+#include "clock.h"
+
+enum clock_ui_field {
+    FIELD_NONE,         /* Not in set mode */
+    FIELD_HOURS,
+    FIELD_MINUTES,
+};
+
+static enum clock_ui_field field = FIELD_NONE;
+static int edit_h, edit_m;
+
+static void show(void)
+{
+    printk("Set clock: %02d:%02d (%s)\n\r", edit_h, edit_m,
+           (field == FIELD_HOURS) ? "hours" : "minutes");
+}
+
+static void adjust(int delta)
+{
+    if (field == FIELD_HOURS) {
+        edit_h = (edit_h + 24 + delta) % 24;
+    } else {
+        edit_m = (edit_m + 60 + delta) % 60;
+    }
+    show();
+}
+
+static int mode_key(enum gesture gesture)
+{
+    int s;
+    int ret;
+
+    switch (gesture) {
+    case GESTURE_LONG:
+        if (field == FIELD_NONE) {
+            clock_get(&edit_h, &edit_m, &s);
+            field = FIELD_HOURS;
+            show();
+        }
+        break;
+    case GESTURE_SHORT:
+        if (field == FIELD_HOURS) {
+            field = FIELD_MINUTES;
+            show();
+        } else if (field == FIELD_MINUTES) {
+            field = FIELD_NONE;
+            ret = clock_set(edit_h, edit_m, 0);
+            if (ret != 0) {
+                return ret;
+            }
+            printk("Clock set to %02d:%02d:00\n\r", edit_h, edit_m);
+        }
+        break;
+    case GESTURE_DOUBLE:
+        if (field != FIELD_NONE) {
+            field = FIELD_NONE;
+            printk("Clock set cancelled\n\r");
+        }
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+int clock_ui_gesture(enum clock_ui_key key, enum gesture gesture)
+{
+    if (key == CLOCK_UI_MODE) {
+        return mode_key(gesture);
+    }
+    if (field == FIELD_NONE || gesture == GESTURE_DOUBLE) {
+        return 0;
+    }
+
+    /* Short press: one step. Held: one step at the long press, then one
+     * per repeat */
+    adjust((key == CLOCK_UI_UP) ? 1 : -1);
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+/*
+ * Clock-set UI on three buttons
+ *
+ *   MODE long press    enter set mode, on the hours
+ *   UP / DOWN          +1 / -1 on the field being set; held, they repeat
+ *   MODE short press   next field (hours, minutes), then set the clock
+ *                      with the seconds at 0
+ *   MODE double press  leave set mode without changes
+ * Gestures outside set mode, other than the MODE long press, are ignored.
+ */
+
+#ifndef CLOCK_UI_H
+#define CLOCK_UI_H
+
+#include "gesture.h"
+
+enum clock_ui_key {
+    CLOCK_UI_MODE,
+    CLOCK_UI_UP,
+    CLOCK_UI_DOWN,
+};
+
+/* Handle a gesture of "key", in thread context. Returns 0 or the
+ * clock_set() error */
+int clock_ui_gesture(enum clock_ui_key key, enum gesture gesture);
+
+#endif /* CLOCK_UI_H */
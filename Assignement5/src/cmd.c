@@ -0,0 +1,384 @@
+/*
+ * UART command interface
+ *
+ * The UART ISR drains the RX FIFO into a ring buffer and wakes the command
+ * thread when it has seen a line terminator. The ring buffer has a single
+ * producer (the ISR) and a single consumer (the command thread) and needs
+ * no lock: each side only writes its own index.
+ *
+ * Lines are never copied out of the ring: the parser walks tokens as
+ * (position, length) spans over the masked ring indices, so a line may
+ * wrap around the end of the buffer. The ring only has to hold the lines
+ * that arrive while one command executes; the command thread runs below
+ * the application threads so parsing never delays the clock tick.
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/uart.h>
+#include <sys/printk.h>
+#include <sys/atomic.h>
+#include <errno.h>
+
+#include "cmd.h"
+#include "clock.h"
+#include "manual.h"
+#include "pwm_out.h"
+#include "load_mon.h"
+#include "debounce.h"
+#include "prof.h"
+#include "power.h"
+#include "gesture.h"
+#include "metrics.h"
+#include "tsync.h"
+#include "telem.h"
+#include "evt_log.h"
+
+#define CMD_STACK_SIZE 1024
+#define CMD_LINE_MAX CONFIG_APP_CMD_LINE_MAX
+#define RING_SIZE CONFIG_APP_CMD_RING_SIZE
+#define RING_MASK (RING_SIZE - 1)
+
+BUILD_ASSERT((RING_SIZE & RING_MASK) == 0, "Ring size must be a power of two");
+BUILD_ASSERT(RING_SIZE >= 2 * CMD_LINE_MAX, "Ring must hold at least two lines");
+
+static const struct device *uart_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
+
+/* RX ring buffer */
+static char ring[RING_SIZE];
+static atomic_t ring_head;      /* Written by the ISR only */
+static atomic_t ring_tail;      /* Written by the command thread only */
+static K_SEM_DEFINE(line_ready, 0, 1);
+
+static struct cmd_stats stats;
+
+METRIC_COUNTER_DEFINE(cmd_rx_dropped);
+METRIC_COUNTER_DEFINE(cmd_errors);
+
+/* Token: a span of the ring buffer */
+struct tok {
+    uint32_t pos;
+    uint32_t len;
+};
+
+static inline char ring_at(uint32_t i)
+{
+    return ring[i & RING_MASK];
+}
+
+static inline bool is_eol(char c)
+{
+    return c == '\n' || c == '\r';
+}
+
+static void uart_isr(const struct device *dev, void *user_data)
+{
+    uint8_t buf[16];
+    bool eol = false;
+    int n;
+
+    while (uart_irq_update(dev) && uart_irq_rx_ready(dev)) {
+        uint32_t head = atomic_get(&ring_head);
+        uint32_t fill;
+
+        n = uart_fifo_read(dev, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+
+        fill = head - atomic_get(&ring_tail);
+        for (int i = 0; i < n; i++) {
+            if (fill == RING_SIZE) {
+                stats.dropped += n - i;
+                metric_add(METRIC(cmd_rx_dropped), n - i);
+                break;
+            }
+            ring[head & RING_MASK] = buf[i];
+            head++;
+            fill++;
+            eol |= is_eol(buf[i]);
+        }
+        stats.max_fill = MAX(stats.max_fill, fill);
+        atomic_set(&ring_head, head);
+    }
+
+    if (uart_err_check(dev) > 0) {
+        stats.uart_errors++;
+    }
+
+    /* A ring close to full is handed over as well, so the parser can drop
+     * an overlong line before it blocks the rest of the input */
+    if (eol || (atomic_get(&ring_head) - atomic_get(&ring_tail)) > CMD_LINE_MAX) {
+        k_sem_give(&line_ready);
+    }
+}
+
+/* Next space-separated token in [*pos, end). Returns false at end of line */
+static bool tok_next(uint32_t *pos, uint32_t end, struct tok *t)
+{
+    while (*pos != end && ring_at(*pos) == ' ') {
+        (*pos)++;
+    }
+    t->pos = *pos;
+    while (*pos != end && ring_at(*pos) != ' ') {
+        (*pos)++;
+    }
+    t->len = *pos - t->pos;
+
+    return t->len > 0;
+}
+
+static bool tok_eq(const struct tok *t, const char *s)
+{
+    uint32_t i;
+
+    for (i = 0; i < t->len; i++) {
+        if (s[i] != ring_at(t->pos + i)) {
+            return false;
+        }
+    }
+
+    return s[i] == '\0';
+}
+
+/* Parse an unsigned decimal field of "t" starting at *i, stopping at the
+ * end of the token or at a non-digit. Returns false if no digit was read */
+static bool tok_uint(const struct tok *t, uint32_t *i, uint32_t *val)
+{
+    uint32_t start = *i;
+    uint32_t v = 0;
+
+    while (*i < t->len) {
+        char c = ring_at(t->pos + *i);
+
+        if (c < '0' || c > '9' || v > 99999) {
+            break;
+        }
+        v = v * 10 + (c - '0');
+        (*i)++;
+    }
+    *val = v;
+
+    return *i != start;
+}
+
+/* Expect character "c" at *i */
+static bool tok_sep(const struct tok *t, uint32_t *i, char c)
+{
+    if (*i < t->len && ring_at(t->pos + *i) == c) {
+        (*i)++;
+        return true;
+    }
+
+    return false;
+}
+
+/* set time HH:MM:SS */
+static int cmd_set_time(uint32_t *pos, uint32_t end)
+{
+    struct tok t;
+    uint32_t i = 0;
+    uint32_t h, m, s;
+
+    if (!tok_next(pos, end, &t) ||
+        !tok_uint(&t, &i, &h) || !tok_sep(&t, &i, ':') ||
+        !tok_uint(&t, &i, &m) || !tok_sep(&t, &i, ':') ||
+        !tok_uint(&t, &i, &s) || i != t.len) {
+        return -EINVAL;
+    }
+
+    return clock_set(h, m, s);
+}
+
+/* set date YYYY-MM-DD */
+static int cmd_set_date(uint32_t *pos, uint32_t end)
+{
+    struct tok t;
+    uint32_t i = 0;
+    uint32_t y, m, d;
+
+    if (!tok_next(pos, end, &t) ||
+        !tok_uint(&t, &i, &y) || !tok_sep(&t, &i, '-') ||
+        !tok_uint(&t, &i, &m) || !tok_sep(&t, &i, '-') ||
+        !tok_uint(&t, &i, &d) || i != t.len) {
+        return -EINVAL;
+    }
+
+    return clock_set_date(y, m, d);
+}
+
+/* set duty PCT[.D] [PIN] */
+static int cmd_set_duty(uint32_t *pos, uint32_t end)
+{
+    struct manual_cmd cmd = {
+        .type = MANUAL_CMD_SET_DUTY,
+        .pin = MANUAL_PIN_LED,
+    };
+    struct tok t;
+    uint32_t i = 0;
+    uint32_t pct, tenth = 0;
+
+    if (!tok_next(pos, end, &t) || !tok_uint(&t, &i, &pct)) {
+        return -EINVAL;
+    }
+    if (tok_sep(&t, &i, '.')) {
+        if (i + 1 != t.len || !tok_uint(&t, &i, &tenth)) {
+            return -EINVAL;
+        }
+    }
+    if (i != t.len || pct * 10 + tenth > 1000) {
+        return -EINVAL;
+    }
+    cmd.permille = (uint16_t)(pct * 10 + tenth);
+
+    if (tok_next(pos, end, &t)) {
+        i = 0;
+        if (!tok_uint(&t, &i, &cmd.pin) || i != t.len || pwm_out_channel(cmd.pin) < 0) {
+            return -EINVAL;
+        }
+    }
+
+    return manual_post(&cmd);
+}
+
+static int cmd_dump_stats(void)
+{
+    struct cmd_stats s;
+
+    if (IS_ENABLED(CONFIG_APP_LOAD_MON)) {
+        load_mon_dump();
+    }
+    if (IS_ENABLED(CONFIG_APP_DEBOUNCE)) {
+        debounce_dump();
+    }
+    if (IS_ENABLED(CONFIG_APP_GESTURE)) {
+        gesture_dump();
+    }
+    if (IS_ENABLED(CONFIG_APP_POWER)) {
+        power_dump();
+    }
+    if (IS_ENABLED(CONFIG_APP_TSYNC)) {
+        tsync_dump();
+    }
+    if (IS_ENABLED(CONFIG_APP_TELEM)) {
+        telem_dump();
+    }
+
+    cmd_stats_get(&s);
+    printk("cmd: %u lines, %u errors, %u too long, %u bytes dropped, "
+           "%u UART errors, ring max %u/%u\n\r",
+           s.lines, s.errors, s.too_long, s.dropped, s.uart_errors,
+           s.max_fill, RING_SIZE);
+
+    return 0;
+}
+
+/* Execute the line [pos, end). Returns 0, a negative errno, or 1 if empty */
+static int cmd_exec(uint32_t pos, uint32_t end)
+{
+    struct tok verb, obj, extra;
+    int ret;
+
+    if (!tok_next(&pos, end, &verb)) {
+        return 1;
+    }
+    if (!tok_next(&pos, end, &obj)) {
+        return -EINVAL;
+    }
+
+    if (tok_eq(&verb, "set") && tok_eq(&obj, "time")) {
+        ret = cmd_set_time(&pos, end);
+    } else if (tok_eq(&verb, "set") && tok_eq(&obj, "date")) {
+        ret = cmd_set_date(&pos, end);
+    } else if (tok_eq(&verb, "set") && tok_eq(&obj, "duty")) {
+        ret = cmd_set_duty(&pos, end);
+    } else if (tok_eq(&verb, "dump") && tok_eq(&obj, "stats")) {
+        ret = cmd_dump_stats();
+    } else if (tok_eq(&verb, "dump") && tok_eq(&obj, "metrics")) {
+        metrics_describe();
+        metrics_dump();
+        ret = 0;
+    } else if (IS_ENABLED(CONFIG_APP_PROF) &&
+               tok_eq(&verb, "dump") && tok_eq(&obj, "prof")) {
+        prof_dump();
+        ret = 0;
+    } else {
+        return -ENOTSUP;
+    }
+
+    /* Trailing garbage */
+    if (ret == 0 && tok_next(&pos, end, &extra)) {
+        ret = -EINVAL;
+    }
+
+    return ret;
+}
+
+static void cmd_thread_code(void *argA, void *argB, void *argC)
+{
+    uint32_t line = 0;      /* Start of the current line */
+    uint32_t scan = 0;      /* Next byte to look at */
+    bool discard = false;   /* Skipping the rest of an overlong line */
+    int ret;
+
+    if (!device_is_ready(uart_dev)) {
+        printk("Error: command UART not ready\n\r");
+        return;
+    }
+
+    uart_irq_callback_user_data_set(uart_dev, uart_isr, NULL);
+    uart_irq_rx_enable(uart_dev);
+
+    while (1) {
+        uint32_t head;
+
+        k_sem_take(&line_ready, K_FOREVER);
+        head = atomic_get(&ring_head);
+
+        for (; scan != head; scan++) {
+            if (!is_eol(ring_at(scan))) {
+                if (!discard && scan - line >= CMD_LINE_MAX) {
+                    stats.too_long++;
+                    printk("ERR %d\n\r", -ENOBUFS);
+                    discard = true;
+                }
+                if (discard) {
+                    /* Release the bytes right away */
+                    line = scan + 1;
+                    atomic_set(&ring_tail, line);
+                }
+                continue;
+            }
+
+            if (!discard) {
+                ret = cmd_exec(line, scan);
+                if (ret == 0) {
+                    stats.lines++;
+                    printk("OK\n\r");
+                } else if (ret < 0) {
+                    stats.errors++;
+                    metric_inc(METRIC(cmd_errors));
+                    if (IS_ENABLED(CONFIG_APP_EVT_LOG)) {
+                        evt_log(EVT_CMD_ERR, (uint16_t)-ret);
+                    }
+                    printk("ERR %d\n\r", ret);
+                }
+            }
+            discard = false;
+            line = scan + 1;
+            atomic_set(&ring_tail, line);
+        }
+    }
+}
+
+void cmd_stats_get(struct cmd_stats *s)
+{
+    unsigned int key = irq_lock();
+
+    *s = stats;
+    irq_unlock(key);
+}
+
+K_THREAD_DEFINE(cmd_thread, CMD_STACK_SIZE, cmd_thread_code,
+                NULL, NULL, NULL, CONFIG_APP_CMD_PRIO, 0, 0);
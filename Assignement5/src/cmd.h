@@ -0,0 +1,33 @@
+/*
+ * UART command interface
+ *
+ * Lines received on the console UART are parsed in place in the RX ring
+ * buffer. Commands (case sensitive, CR and/or LF terminated):
+ *   set time HH:MM:SS        set the clock
+ *   set date YYYY-MM-DD      set the date
+ *   set duty PCT[.D] [PIN]   set a PWM duty-cycle (default: the BUT1 LED)
+ *   dump stats               print load, debounce, gesture, power, time
+ *                            sync, telemetry and command statistics
+ *   dump metrics             print the metrics registry and its frame layout
+ *   dump prof                print and clear the profiler histogram
+ * Each command is answered with "OK" or "ERR <errno>".
+ */
+
+#ifndef CMD_H
+#define CMD_H
+
+#include <zephyr.h>
+
+struct cmd_stats {
+    uint32_t lines;         /* Commands executed successfully */
+    uint32_t errors;        /* Unknown or failed commands */
+    uint32_t too_long;      /* Lines discarded for exceeding the max length */
+    uint32_t dropped;       /* Bytes lost because the ring buffer was full */
+    uint32_t uart_errors;   /* Overrun/framing errors reported by the UART */
+    uint32_t max_fill;      /* Ring buffer high-water mark (bytes) */
+};
+
+/* Copy the current statistics */
+void cmd_stats_get(struct cmd_stats *stats);
+
+#endif /* CMD_H */
@@ -0,0 +1,210 @@
+/*
+ * Fade curve generator
+ *
+ * A fade of n steps samples the shape at x = 1/n, 2/n, ..., 1. x is
+ * carried as a 31-bit phase: the table segment in the top 7 bits, then a
+ * 14-bit interpolation fraction. Before stepping, the Q15 shape table is
+ * rescaled to [from, to] (CURVE_SEGMENTS + 1 multiplies), so each step is
+ * an interpolation between two compare values and nothing more:
+ *     y = (p[k] * (1 - f) + p[k + 1] * f) >> 14
+ * With the DSP extension, p[k] and p[k + 1] are read as one word and the
+ * weights (1 - f, f) built as one packed word, so the interpolation is a
+ * single SMLAD; contiguous output is written two steps per word.
+ * The portable version computes the same expression on plain integers.
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+
+#include "curve.h"
+
+#if defined(CONFIG_CPU_CORTEX_M) && defined(__ARM_FEATURE_DSP)
+#include <soc.h>            /* CMSIS core: SIMD intrinsics */
+#define CURVE_DSP 1
+#endif
+
+/* Phase: segment in bits 24..30, fraction in bits 10..23 */
+#define PHASE_ONE BIT(31)
+#define PHASE_SEGMENT(p) ((p) >> 24)
+#define PHASE_FRAC(p) (((p) >> 10) & (FRAC_ONE - 1))
+#define FRAC_BITS 14
+#define FRAC_ONE BIT(FRAC_BITS)
+
+BUILD_ASSERT(CURVE_SEGMENTS == 128, "The phase holds a 7-bit segment");
+
+/* Shapes at x = k / CURVE_SEGMENTS, Q15. Generated by scripts/curve_tables.py */
+static const uint16_t curve_tables[CURVE_SHAPES][CURVE_SEGMENTS + 1] = {
+    [CURVE_LINEAR] = {
+            0,   256,   512,   768,  1024,  1280,  1536,  1792,
+         2048,  2304,  2560,  2816,  3072,  3328,  3584,  3840,
+         4096,  4352,  4608,  4864,  5120,  5376,  5632,  5888,
+         6144,  6400,  6656,  6912,  7168,  7424,  7680,  7936,
+         8192,  8448,  8704,  8960,  9216,  9472,  9728,  9984,
+        10240, 10496, 10752, 11008, 11264, 11520, 11776, 12032,
+        12288, 12544, 12800, 13056, 13312, 13568, 13824, 14080,
+        14336, 14592, 14848, 15104, 15360, 15616, 15872, 16128,
+        16384, 16639, 16895, 17151, 17407, 17663, 17919, 18175,
+        18431, 18687, 18943, 19199, 19455, 19711, 19967, 20223,
+        20479, 20735, 20991, 21247, 21503, 21759, 22015, 22271,
+        22527, 22783, 23039, 23295, 23551, 23807, 24063, 24319,
+        24575, 24831, 25087, 25343, 25599, 25855, 26111, 26367,
+        26623, 26879, 27135, 27391, 27647, 27903, 28159, 28415,
+        28671, 28927, 29183, 29439, 29695, 29951, 30207, 30463,
+        30719, 30975, 31231, 31487, 31743, 31999, 32255, 32511,
+        32767,
+    },
+    [CURVE_GAMMA] = {
+            0,     1,     3,     8,    16,    26,    39,    55,
+           74,    95,   120,   148,   179,   214,   252,   293,
+          338,   386,   438,   493,   552,   614,   681,   751,
+          824,   902,   983,  1068,  1157,  1250,  1347,  1447,
+         1552,  1661,  1773,  1890,  2011,  2136,  2265,  2398,
+         2536,  2677,  2823,  2973,  3127,  3286,  3449,  3616,
+         3787,  3963,  4143,  4327,  4516,  4710,  4907,  5109,
+         5316,  5527,  5743,  5963,  6187,  6417,  6650,  6888,
+         7131,  7379,  7631,  7887,  8149,  8415,  8685,  8961,
+         9241,  9525,  9815, 10109, 10408, 10712, 11020, 11333,
+        11651, 11974, 12302, 12634, 12971, 13314, 13661, 14013,
+        14369, 14731, 15098, 15469, 15846, 16227, 16613, 17005,
+        17401, 17802, 18208, 18620, 19036, 19457, 19884, 20315,
+        20751, 21193, 21640, 22091, 22548, 23010, 23477, 23949,
+        24426, 24908, 25396, 25889, 26387, 26890, 27398, 27911,
+        28430, 28954, 29483, 30017, 30556, 31101, 31651, 32206,
+        32767,
+    },
+    [CURVE_EASE] = {
+            0,     0,     0,     2,     4,     8,    13,    21,
+           32,    46,    62,    83,   108,   137,   171,   211,
+          256,   307,   364,   429,   500,   579,   665,   760,
+          864,   977,  1098,  1230,  1372,  1524,  1687,  1862,
+         2048,  2246,  2456,  2680,  2916,  3166,  3429,  3707,
+         4000,  4307,  4630,  4969,  5324,  5695,  6083,  6489,
+         6912,  7353,  7812,  8290,  8788,  9305,  9841, 10398,
+        10976, 11574, 12194, 12836, 13500, 14186, 14895, 15627,
+        16384, 17140, 17872, 18581, 19267, 19931, 20573, 21193,
+        21791, 22369, 22926, 23462, 23979, 24477, 24955, 25414,
+        25855, 26278, 26684, 27072, 27443, 27798, 28137, 28460,
+        28767, 29060, 29338, 29601, 29851, 30087, 30311, 30521,
+        30719, 30905, 31080, 31243, 31395, 31537, 31669, 31790,
+        31903, 32007, 32102, 32188, 32267, 32338, 32403, 32460,
+        32511, 32556, 32596, 32630, 32659, 32684, 32705, 32721,
+        32735, 32746, 32754, 32759, 32763, 32765, 32767, 32767,
+        32767,
+    },
+    [CURVE_SINE] = {
+            0,     5,    20,    44,    79,   123,   177,   241,
+          315,   398,   491,   593,   705,   827,   958,  1098,
+         1247,  1406,  1573,  1749,  1935,  2128,  2331,  2542,
+         2761,  2989,  3224,  3468,  3719,  3978,  4244,  4518,
+         4799,  5086,  5381,  5682,  5990,  6304,  6624,  6950,
+         7281,  7618,  7961,  8308,  8660,  9017,  9379,  9744,
+        10114, 10487, 10864, 11244, 11628, 12014, 12403, 12794,
+        13187, 13583, 13980, 14378, 14778, 15178, 15580, 15981,
+        16383, 16786, 17187, 17589, 17989, 18389, 18787, 19184,
+        19580, 19973, 20364, 20753, 21139, 21523, 21903, 22280,
+        22653, 23023, 23388, 23750, 24107, 24459, 24806, 25149,
+        25486, 25817, 26143, 26463, 26777, 27085, 27386, 27681,
+        27968, 28249, 28523, 28789, 29048, 29299, 29543, 29778,
+        30006, 30225, 30436, 30639, 30832, 31018, 31194, 31361,
+        31520, 31669, 31809, 31940, 32062, 32174, 32276, 32369,
+        32452, 32526, 32590, 32644, 32688, 32723, 32747, 32762,
+        32767,
+    },
+};
+
+/* Check the arguments, rescale the shape table to [from, to] and return
+ * the phase increment per step */
+static int curve_prepare(int16_t scaled[], size_t n, uint16_t from, uint16_t to,
+                         enum curve_shape shape, uint32_t *step)
+{
+    const uint16_t *table;
+    int32_t delta = (int32_t)to - (int32_t)from;
+
+    if (n == 0 || shape >= CURVE_SHAPES || from > CURVE_VALUE_MAX || to > CURVE_VALUE_MAX) {
+        return -EINVAL;
+    }
+
+    table = curve_tables[shape];
+    for (int k = 0; k <= CURVE_SEGMENTS; k++) {
+        scaled[k] = (int16_t)(from + ((delta * table[k] + (1 << 14)) >> 15));
+    }
+    /* Rounded down, so that no step before the last reaches PHASE_ONE */
+    *step = PHASE_ONE / n;
+
+    return 0;
+}
+
+static inline uint16_t curve_at(const int16_t scaled[], uint32_t phase)
+{
+    const int16_t *p = &scaled[PHASE_SEGMENT(phase)];
+    int32_t f = (int32_t)PHASE_FRAC(phase);
+
+    return (uint16_t)((p[0] * (FRAC_ONE - f) + p[1] * f + FRAC_ONE / 2) >> FRAC_BITS);
+}
+
+int curve_fill_portable(uint16_t *out, size_t n, size_t stride, uint16_t from, uint16_t to,
+                        enum curve_shape shape)
+{
+    int16_t scaled[CURVE_SEGMENTS + 1];
+    uint32_t step, phase = 0;
+    int ret = curve_prepare(scaled, n, from, to, shape, &step);
+
+    if (ret) {
+        return ret;
+    }
+    for (size_t i = 0; i + 1 < n; i++) {
+        phase += step;
+        out[i * stride] = curve_at(scaled, phase);
+    }
+    out[(n - 1) * stride] = to;
+
+    return 0;
+}
+
+#if defined(CURVE_DSP)
+static inline uint32_t curve_at_dsp(const int16_t scaled[], uint32_t phase)
+{
+    uint32_t f = PHASE_FRAC(phase);
+    /* p[k] in the low half, p[k + 1] in the high half */
+    uint32_t points = __UNALIGNED_UINT32_READ(&scaled[PHASE_SEGMENT(phase)]);
+    /* 1 - f in the low half, f in the high half */
+    uint32_t weights = FRAC_ONE + f * 0xffff;
+
+    return __SMLAD(points, weights, FRAC_ONE / 2) >> FRAC_BITS;
+}
+
+int curve_fill(uint16_t *out, size_t n, size_t stride, uint16_t from, uint16_t to,
+               enum curve_shape shape)
+{
+    int16_t scaled[CURVE_SEGMENTS + 1];
+    uint32_t step, phase = 0;
+    size_t i = 0;
+    int ret = curve_prepare(scaled, n, from, to, shape, &step);
+
+    if (ret) {
+        return ret;
+    }
+    if (stride == 1) {
+        for (; i + 2 < n; i += 2) {
+            uint32_t y0 = curve_at_dsp(scaled, phase + step);
+            uint32_t y1 = curve_at_dsp(scaled, phase + 2 * step);
+
+            phase += 2 * step;
+            __UNALIGNED_UINT32_WRITE(&out[i], __PKHBT(y0, y1, 16));
+        }
+    }
+    for (; i + 1 < n; i++) {
+        phase += step;
+        out[i * stride] = (uint16_t)curve_at_dsp(scaled, phase);
+    }
+    out[(n - 1) * stride] = to;
+
+    return 0;
+}
+#else
+int curve_fill(uint16_t *out, size_t n, size_t stride, uint16_t from, uint16_t to,
+               enum curve_shape shape)
+{
+    return curve_fill_portable(out, n, stride, from, to, shape);
+}
+#endif /* CURVE_DSP */
@@ -0,0 +1,45 @@
+/*
+ * Fade curve generator
+ *
+ * Fills PWM compare buffers with the steps of a fade between two compare
+ * values along a shape. Each shape is a table of CURVE_SEGMENTS + 1
+ * points, rescaled once to the fade's range and linearly interpolated for
+ * every step. On Cortex-M with the DSP extension (nRF52840) the
+ * interpolation is one packed dual 16-bit multiply-accumulate per step;
+ * elsewhere (native_posix) a portable version gives identical output.
+ */
+
+#ifndef CURVE_H
+#define CURVE_H
+
+#include <zephyr/types.h>
+#include <stddef.h>
+
+/* Points per shape table, less one */
+#define CURVE_SEGMENTS 128
+
+/* Largest compare value (15-bit PWM counter) */
+#define CURVE_VALUE_MAX 0x7fff
+
+enum curve_shape {
+    CURVE_LINEAR,
+    CURVE_GAMMA,        /* x^2.2: even steps of perceived LED brightness */
+    CURVE_EASE,         /* Cubic ease-in-out */
+    CURVE_SINE,         /* Half cosine ease-in-out */
+    CURVE_SHAPES,
+};
+
+/* Write the "n" steps of a fade from "from" to "to" along "shape" to
+ * out[0], out[stride], ..., out[(n - 1) * stride]. The start value is not
+ * included; the last step is "to". Returns 0 or -EINVAL */
+int curve_fill(uint16_t *out, size_t n, size_t stride, uint16_t from, uint16_t to,
+               enum curve_shape shape);
+
+/* Portable implementation of curve_fill(), for comparison */
+int curve_fill_portable(uint16_t *out, size_t n, size_t stride, uint16_t from, uint16_t to,
+                        enum curve_shape shape);
+
+/* Print the cost of a fade for each shape (CONFIG_APP_CURVE_BENCH) */
+void curve_bench_run(void);
+
+#endif /* CURVE_H */
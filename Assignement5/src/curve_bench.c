@@ -0,0 +1,142 @@
+/*
+ * Fade curve generator benchmark
+ *
+ * For each shape, times the generation of a BENCH_STEPS fade and prints
+ * the cost per step of:
+ *  - curve_fill() into a contiguous buffer
+ *  - curve_fill() into an interleaved 4-channel buffer (the cross-fade
+ *    layout of pwm_out)
+ *  - curve_fill_portable(), the plain integer version
+ *  - for the linear shape, the per-step division previously used for
+ *    cross-fades
+ * and whether a cross-fade (PWM_OUT_CHANNELS interleaved fills, as
+ * pwm_out_hw_crossfade() does) is rebuilt within one PWM period at
+ * CONFIG_APP_PWM_FREQ_HZ. The best of BENCH_RUNS runs is kept. Every
+ * output is checked against curve_fill_portable().
+ * Costs are in CPU cycles on Cortex-M (DWT), in kernel timer cycles
+ * elsewhere; in simulated time (native_posix) they do not mean much.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+
+#include "curve.h"
+#include "pwm_out.h"
+
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+#include "dwt.h"
+#endif
+
+#define BENCH_STEPS 1000
+#define BENCH_RUNS 8
+
+static uint16_t buf[BENCH_STEPS * PWM_OUT_CHANNELS];
+static uint16_t ref[BENCH_STEPS];
+
+static const char *const shape_names[CURVE_SHAPES] = {
+    [CURVE_LINEAR] = "linear",
+    [CURVE_GAMMA] = "gamma",
+    [CURVE_EASE] = "ease",
+    [CURVE_SINE] = "sine",
+};
+
+static inline uint32_t bench_cycles(void)
+{
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+    return dwt_cycles();
+#else
+    return k_cycle_get_32();
+#endif
+}
+
+static uint32_t bench_ns(uint32_t cycles)
+{
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+    return dwt_cycles_to_ns(cycles);
+#else
+    return (uint32_t)k_cyc_to_ns_floor64(cycles);
+#endif
+}
+
+/* The cross-fade step computation before curve_fill() */
+static int fill_div(uint16_t *out, size_t n, size_t stride, uint16_t from, uint16_t to,
+                    enum curve_shape shape)
+{
+    int32_t delta = (int32_t)to - (int32_t)from;
+
+    for (size_t s = 1; s <= n; s++) {
+        out[(s - 1) * stride] = (uint16_t)(from + (delta * (int32_t)s) / (int32_t)n);
+    }
+
+    return 0;
+}
+
+typedef int (*fill_fn)(uint16_t *out, size_t n, size_t stride, uint16_t from, uint16_t to,
+                       enum curve_shape shape);
+
+/* Best time of BENCH_RUNS fades, in cycles. Counts outputs differing
+ * from the reference in "*bad" (not for the division) */
+static uint32_t bench_fill(fill_fn fn, size_t stride, enum curve_shape shape, uint32_t *bad)
+{
+    uint32_t best = UINT32_MAX;
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        /* Alternate directions, as successive brightness changes do */
+        uint16_t from = (run & 1) ? 30000 : 100;
+        uint16_t to = (run & 1) ? 100 : 30000;
+        uint32_t t0, cycles;
+
+        t0 = bench_cycles();
+        fn(buf, BENCH_STEPS, stride, from, to, shape);
+        cycles = bench_cycles() - t0;
+        best = MIN(best, cycles);
+
+        if (fn != fill_div) {
+            curve_fill_portable(ref, BENCH_STEPS, 1, from, to, shape);
+            for (size_t i = 0; i < BENCH_STEPS; i++) {
+                *bad += (buf[i * stride] != ref[i]);
+            }
+        }
+    }
+
+    return best;
+}
+
+static void print_cost(const char *what, uint32_t cycles)
+{
+    uint32_t per_step = (uint32_t)((100ULL * cycles) / BENCH_STEPS);
+
+    printk("  %-10s %7u cycles %3u.%02u/step %6u us\n\r", what, cycles,
+           per_step / 100, per_step % 100, bench_ns(cycles) / 1000);
+}
+
+void curve_bench_run(void)
+{
+    uint32_t period_ns = NSEC_PER_SEC / CONFIG_APP_PWM_FREQ_HZ;
+
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+    dwt_init();
+#endif
+    printk("Curve bench (%u steps, %s, PWM period %u us):\n\r", BENCH_STEPS,
+           IS_ENABLED(CONFIG_CPU_CORTEX_M_HAS_DWT) ? "CPU cycles" : "timer cycles",
+           period_ns / 1000);
+
+    for (int shape = 0; shape < CURVE_SHAPES; shape++) {
+        uint32_t bad = 0;
+        uint32_t fill, strided, portable;
+
+        fill = bench_fill(curve_fill, 1, shape, &bad);
+        strided = bench_fill(curve_fill, PWM_OUT_CHANNELS, shape, &bad);
+        portable = bench_fill(curve_fill_portable, 1, shape, &bad);
+
+        printk(" %s: %s one PWM period%s\n\r", shape_names[shape],
+               bench_ns(PWM_OUT_CHANNELS * strided) <= period_ns ? "within" : "exceeds",
+               bad ? ", OUTPUT MISMATCH" : "");
+        print_cost("fill", fill);
+        print_cost("fill x4", strided);
+        print_cost("portable", portable);
+        if (shape == CURVE_LINEAR) {
+            print_cost("division", bench_fill(fill_div, 1, shape, &bad));
+        }
+    }
+}
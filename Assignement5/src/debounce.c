@@ -0,0 +1,173 @@
+/*
+ * Shared-timer input debouncing
+ *
+ * Integrator filter: every sample moves the integrator one step towards
+ * the raw level, and the debounced state only changes when the integrator
+ * reaches 0 or "threshold". A bounce therefore delays the decision but can
+ * never produce an extra state change. An input stops being sampled once
+ * the integrator is saturated at its debounced state.
+ *
+ * After re-enabling the edge interrupt the level is checked again, so an
+ * edge that happened between the last sample and the re-enable is not lost.
+ */
+
+#include <zephyr.h>
+#include <sys/atomic.h>
+#include <sys/printk.h>
+#include <errno.h>
+#include <string.h>
+
+#include "debounce.h"
+#include "hot.h"
+#include "metrics.h"
+
+#define MAX_INPUTS CONFIG_APP_DEBOUNCE_MAX_INPUTS
+
+BUILD_ASSERT(MAX_INPUTS <= 32, "Settling set is a 32-bit mask");
+
+static struct debounce_input *inputs[MAX_INPUTS];
+static int n_inputs;
+static atomic_t settling;       /* Bit i set while inputs[i] is sampled */
+
+/* Edge to debounced state change, log2 buckets up to 16 ms and above */
+METRIC_HISTOGRAM_DEFINE(debounce_latency_us, 16);
+
+static void debounce_sample(struct k_timer *timer);
+static K_TIMER_DEFINE(sample_timer, debounce_sample, NULL);
+
+static void latency_add(struct debounce_latency *l, int64_t edge_ticks)
+{
+    uint32_t us = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks() - edge_ticks);
+
+    metric_observe(METRIC(debounce_latency_us), us);
+    l->last_us = us;
+    if (l->count == 0 || us < l->min_us) {
+        l->min_us = us;
+    }
+    if (us > l->max_us) {
+        l->max_us = us;
+    }
+    l->count++;
+}
+
+/* Begin sampling "in". Edge interrupts stay off until it settles */
+static APP_HOT void settle_start(struct debounce_input *in)
+{
+    in->edge_ticks = k_uptime_ticks();
+    if (atomic_or(&settling, BIT(in->idx)) == 0) {
+        k_timer_start(&sample_timer, K_MSEC(CONFIG_APP_DEBOUNCE_SAMPLE_MS),
+                      K_MSEC(CONFIG_APP_DEBOUNCE_SAMPLE_MS));
+    }
+}
+
+static APP_HOT void edge_isr(const struct device *port, struct gpio_callback *cb, uint32_t pins)
+{
+    struct debounce_input *in = CONTAINER_OF(cb, struct debounce_input, gpio_cb);
+
+    gpio_pin_interrupt_configure(port, in->pin, GPIO_INT_DISABLE);
+    settle_start(in);
+}
+
+/* Returns true once the input has settled */
+static APP_HOT bool input_sample(struct debounce_input *in)
+{
+    int level = gpio_pin_get(in->port, in->pin);
+
+    if (level > 0) {
+        if (in->integrator < in->threshold) {
+            in->integrator++;
+        }
+    } else if (in->integrator > 0) {
+        in->integrator--;
+    }
+
+    if (in->integrator == in->threshold && !in->active) {
+        in->active = true;
+        latency_add(&in->press, in->edge_ticks);
+        in->cb(in, true);
+    } else if (in->integrator == 0 && in->active) {
+        in->active = false;
+        latency_add(&in->release, in->edge_ticks);
+        in->cb(in, false);
+    }
+
+    return in->integrator == (in->active ? in->threshold : 0);
+}
+
+static APP_HOT void debounce_sample(struct k_timer *timer)
+{
+    uint32_t mask = (uint32_t)atomic_get(&settling);
+
+    while (mask != 0) {
+        int i = __builtin_ctz(mask);
+        struct debounce_input *in = inputs[i];
+
+        mask &= mask - 1;
+        if (!input_sample(in)) {
+            continue;
+        }
+
+        atomic_and(&settling, ~BIT(i));
+        gpio_pin_interrupt_configure(in->port, in->pin, GPIO_INT_EDGE_BOTH);
+        if ((gpio_pin_get(in->port, in->pin) > 0) != in->active) {
+            gpio_pin_interrupt_configure(in->port, in->pin, GPIO_INT_DISABLE);
+            settle_start(in);
+        }
+    }
+
+    if (atomic_get(&settling) == 0) {
+        k_timer_stop(&sample_timer);
+    }
+}
+
+int debounce_add(struct debounce_input *in, const struct device *port, gpio_pin_t pin,
+                 uint8_t threshold, debounce_cb_t cb)
+{
+    int ret;
+
+    if (n_inputs == MAX_INPUTS) {
+        return -ENOMEM;
+    }
+    if (threshold == 0 || cb == NULL) {
+        return -EINVAL;
+    }
+
+    memset(in, 0, sizeof(*in));
+    in->port = port;
+    in->pin = pin;
+    in->threshold = threshold;
+    in->cb = cb;
+    in->active = (gpio_pin_get(port, pin) > 0);
+    in->integrator = in->active ? threshold : 0;
+    in->idx = n_inputs;
+    inputs[n_inputs++] = in;
+
+    gpio_init_callback(&in->gpio_cb, edge_isr, BIT(pin));
+    ret = gpio_add_callback(port, &in->gpio_cb);
+    if (ret == 0) {
+        ret = gpio_pin_interrupt_configure(port, pin, GPIO_INT_EDGE_BOTH);
+    }
+
+    return ret;
+}
+
+bool debounce_settling(const struct debounce_input *in)
+{
+    return (atomic_get(&settling) & BIT(in->idx)) != 0;
+}
+
+static void latency_print(const char *what, const struct debounce_latency *l)
+{
+    printk("  %s: %u events, last %u us, min %u us, max %u us\n\r", what,
+           l->count, l->last_us, l->min_us, l->max_us);
+}
+
+void debounce_dump(void)
+{
+    for (int i = 0; i < n_inputs; i++) {
+        printk("debounce %s pin %u (%u samples):\n\r", inputs[i]->port->name,
+               inputs[i]->pin, inputs[i]->threshold);
+        latency_print("press", &inputs[i]->press);
+        latency_print("release", &inputs[i]->release);
+    }
+}
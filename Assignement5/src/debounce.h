@@ -0,0 +1,60 @@
+/*
+ * Shared-timer input debouncing
+ *
+ * Any number of GPIO inputs are debounced by one sampling timer. An edge
+ * interrupt only starts the timer and disables further edge interrupts on
+ * that pin; the pin is then sampled into an integrator until it settles,
+ * after which the edge interrupt is re-enabled. With no input settling the
+ * timer is stopped, so idle inputs cost nothing.
+ */
+
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/gpio.h>
+
+struct debounce_input;
+
+/* Debounced state change, called from the sampling timer (ISR context).
+ * "active" is the new logical state of the input. */
+typedef void (*debounce_cb_t)(struct debounce_input *in, bool active);
+
+struct debounce_latency {
+    uint32_t last_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t count;
+};
+
+/* Debounced input, allocated by the caller. Fields are private except
+ * for the latency statistics, which may be read at any time */
+struct debounce_input {
+    const struct device *port;
+    gpio_pin_t pin;
+    uint8_t threshold;          /* Samples needed to change state */
+    uint8_t integrator;         /* 0 .. threshold */
+    bool active;                /* Debounced state */
+    int8_t idx;                 /* Slot in the input table */
+    int64_t edge_ticks;         /* First raw edge of the current transition */
+    debounce_cb_t cb;
+    struct gpio_callback gpio_cb;
+    struct debounce_latency press;      /* Edge to debounced active */
+    struct debounce_latency release;    /* Edge to debounced inactive */
+};
+
+/* Start debouncing "pin" of "port", already configured as an input.
+ * "threshold" is the number of consecutive-equivalent samples (of
+ * APP_DEBOUNCE_SAMPLE_MS each) needed to accept a new state.
+ * Returns 0, -ENOMEM if the input table is full or a GPIO error. */
+int debounce_add(struct debounce_input *in, const struct device *port, gpio_pin_t pin,
+                 uint8_t threshold, debounce_cb_t cb);
+
+/* True while "in" is being sampled, i.e. a debounced edge may follow */
+bool debounce_settling(const struct debounce_input *in);
+
+/* Print the press/release latency of every input */
+void debounce_dump(void);
+
+#endif /* DEBOUNCE_H */
@@ -0,0 +1,32 @@
+/*
+ * DWT cycle counter helpers (Cortex-M)
+ *
+ * CYCCNT counts CPU cycles (64 MHz on the nRF52840) and wraps every ~67 s;
+ * differences of two 32-bit readings are valid across a wrap.
+ */
+
+#ifndef DWT_H
+#define DWT_H
+
+#include <zephyr.h>
+#include <soc.h>
+
+/* Enable the cycle counter. Safe to call more than once */
+static inline void dwt_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t dwt_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+/* CPU cycles to ns */
+static inline uint32_t dwt_cycles_to_ns(uint32_t cycles)
+{
+    return (uint32_t)((uint64_t)cycles * NSEC_PER_SEC / SystemCoreClock);
+}
+
+#endif /* DWT_H */
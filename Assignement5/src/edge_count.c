@@ -0,0 +1,163 @@
+/*
+ * Edge counter on an input pin
+ *
+ * The hardware path uses TIMER1 in low-power counter mode: the GPIOTE
+ * channel of the pin generates an IN event per rising edge and a PPI
+ * channel connects it to the COUNT task. Reading triggers CAPTURE0 and
+ * returns CC[0], so the counter runs untouched in between.
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/gpio.h>
+#include <sys/atomic.h>
+#include <errno.h>
+#include <nrfx_gpiote.h>
+#include <nrfx_ppi.h>
+#include <hal/nrf_timer.h>
+
+#include "edge_count.h"
+#include "power.h"
+
+#define GPIO0_NID DT_NODELABEL(gpio0)
+#define EDGE_PIN CONFIG_APP_EDGE_COUNT_PIN
+#define COUNT_TIMER NRF_TIMER1
+
+static const struct device *gpio0_dev;
+static enum edge_count_path cur_path;
+static bool running;
+
+/* ISR path */
+static struct gpio_callback edge_cb_data;
+static atomic_t isr_count;
+
+/* HW path */
+static nrf_ppi_channel_t ppi_ch;
+
+static void edge_cb(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+    atomic_inc(&isr_count);
+}
+
+static int isr_start(void)
+{
+    int ret;
+
+    ret = gpio_pin_configure(gpio0_dev, EDGE_PIN, GPIO_INPUT | GPIO_PULL_UP);
+    if (ret < 0) {
+        return ret;
+    }
+
+    atomic_clear(&isr_count);
+    gpio_init_callback(&edge_cb_data, edge_cb, BIT(EDGE_PIN));
+    ret = gpio_add_callback(gpio0_dev, &edge_cb_data);
+    if (ret < 0) {
+        return ret;
+    }
+
+    return gpio_pin_interrupt_configure(gpio0_dev, EDGE_PIN, GPIO_INT_EDGE_RISING);
+}
+
+static void isr_stop(void)
+{
+    gpio_pin_interrupt_configure(gpio0_dev, EDGE_PIN, GPIO_INT_DISABLE);
+    gpio_remove_callback(gpio0_dev, &edge_cb_data);
+}
+
+static int hw_start(void)
+{
+    nrfx_gpiote_in_config_t cfg = NRFX_GPIOTE_CONFIG_IN_SENSE_LOTOHI(true);
+
+    cfg.pull = NRF_GPIO_PIN_PULLUP;
+    if (nrfx_gpiote_in_init(EDGE_PIN, &cfg, NULL) != NRFX_SUCCESS) {
+        return -EBUSY;
+    }
+    if (nrfx_ppi_channel_alloc(&ppi_ch) != NRFX_SUCCESS) {
+        nrfx_gpiote_in_uninit(EDGE_PIN);
+        return -EBUSY;
+    }
+
+    nrf_timer_task_trigger(COUNT_TIMER, NRF_TIMER_TASK_STOP);
+    nrf_timer_mode_set(COUNT_TIMER, NRF_TIMER_MODE_LOW_POWER_COUNTER);
+    nrf_timer_bit_width_set(COUNT_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_task_trigger(COUNT_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_task_trigger(COUNT_TIMER, NRF_TIMER_TASK_START);
+
+    nrfx_ppi_channel_assign(ppi_ch, nrfx_gpiote_in_event_addr_get(EDGE_PIN),
+        nrf_timer_task_address_get(COUNT_TIMER, NRF_TIMER_TASK_COUNT));
+    nrfx_ppi_channel_enable(ppi_ch);
+
+    /* Event only: no interrupt per edge */
+    nrfx_gpiote_in_event_enable(EDGE_PIN, false);
+
+    return 0;
+}
+
+static void hw_stop(void)
+{
+    nrfx_gpiote_in_event_disable(EDGE_PIN);
+    nrfx_ppi_channel_disable(ppi_ch);
+    nrfx_ppi_channel_free(ppi_ch);
+    nrfx_gpiote_in_uninit(EDGE_PIN);
+    nrf_timer_task_trigger(COUNT_TIMER, NRF_TIMER_TASK_STOP);
+}
+
+int edge_count_start(enum edge_count_path path)
+{
+    int ret;
+
+    if (gpio0_dev == NULL) {
+        gpio0_dev = device_get_binding(DT_LABEL(GPIO0_NID));
+        if (gpio0_dev == NULL) {
+            return -ENODEV;
+        }
+    }
+
+    edge_count_stop();
+
+    ret = (path == EDGE_COUNT_HW) ? hw_start() : isr_start();
+    if (ret == 0) {
+        cur_path = path;
+        running = true;
+        if (IS_ENABLED(CONFIG_APP_POWER) && path == EDGE_COUNT_HW) {
+            power_hf_get(POWER_HF_EDGE_COUNT);
+        }
+    }
+
+    return ret;
+}
+
+void edge_count_stop(void)
+{
+    if (!running) {
+        return;
+    }
+    if (cur_path == EDGE_COUNT_HW) {
+        hw_stop();
+        if (IS_ENABLED(CONFIG_APP_POWER)) {
+            power_hf_put(POWER_HF_EDGE_COUNT);
+        }
+    } else {
+        isr_stop();
+    }
+    running = false;
+}
+
+uint32_t edge_count_read(void)
+{
+    uint32_t n;
+    unsigned int key;
+
+    if (cur_path == EDGE_COUNT_ISR) {
+        return (uint32_t)atomic_get(&isr_count);
+    }
+
+    /* CAPTURE and read must not interleave with another reader */
+    key = irq_lock();
+    nrf_timer_task_trigger(COUNT_TIMER, NRF_TIMER_TASK_CAPTURE0);
+    n = nrf_timer_cc_get(COUNT_TIMER, NRF_TIMER_CC_CHANNEL0);
+    irq_unlock(key);
+
+    return n;
+}
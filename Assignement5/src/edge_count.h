@@ -0,0 +1,37 @@
+/*
+ * Edge counter on an input pin
+ *
+ * Two interchangeable paths count the rising edges on APP_EDGE_COUNT_PIN:
+ *  - EDGE_COUNT_ISR: a GPIO interrupt per edge increments a counter. Costs
+ *    one interrupt per edge, so the edge rate is bounded by ISR overhead.
+ *  - EDGE_COUNT_HW: the GPIOTE IN event triggers the COUNT task of a TIMER
+ *    in counter mode through PPI. No CPU involvement per edge; the count is
+ *    only captured when read.
+ */
+
+#ifndef EDGE_COUNT_H
+#define EDGE_COUNT_H
+
+#include <zephyr/types.h>
+
+enum edge_count_path {
+    EDGE_COUNT_ISR,
+    EDGE_COUNT_HW,
+};
+
+/* Start counting from zero on the given path (stopping the other one).
+ * Returns 0 or negative errno */
+int edge_count_start(enum edge_count_path path);
+
+/* Stop counting and release the pin, PPI channel and GPIOTE channel */
+void edge_count_stop(void);
+
+/* Edges counted since edge_count_start(). ISR safe */
+uint32_t edge_count_read(void);
+
+#if defined(CONFIG_APP_EDGE_COUNT_BENCH)
+/* Find the highest edge rate each path counts without loss */
+void edge_count_bench_run(void);
+#endif
+
+#endif /* EDGE_COUNT_H */
@@ -0,0 +1,144 @@
+/*
+ * Edge counter benchmark
+ *
+ * Wire APP_EDGE_COUNT_BENCH_OUT_PIN (P0.04 by default, Arduino A1) to
+ * APP_EDGE_COUNT_PIN. A burst of exactly BURST_MS worth of edges is
+ * generated in hardware, without the CPU:
+ *  - TIMER2 (16 MHz) compares at half the edge period and clears; the
+ *    COMPARE0 event toggles the output pin through GPIOTE (PPI channel A)
+ *  - the same event is forked to the COUNT task of TIMER3, which stops
+ *    TIMER2 after 2 * N toggles (= N rising edges) through PPI channel B
+ * The edge rate is raised until a path counts fewer edges than generated;
+ * the last rate counted exactly is its maximum sustainable rate.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <errno.h>
+#include <nrfx_gpiote.h>
+#include <nrfx_ppi.h>
+#include <hal/nrf_timer.h>
+
+#include "edge_count.h"
+
+#define OUT_PIN CONFIG_APP_EDGE_COUNT_BENCH_OUT_PIN
+#define GEN_TIMER NRF_TIMER2
+#define BURST_TIMER NRF_TIMER3
+#define GEN_TIMER_HZ 16000000
+#define BURST_MS 50
+
+/* Rising edges per second */
+static const uint32_t rates[] = {
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000,
+    500000, 1000000, 2000000, 4000000,
+};
+
+static nrf_ppi_channel_t ppi_gen, ppi_burst;
+
+static int gen_init(void)
+{
+    nrfx_gpiote_out_config_t cfg = NRFX_GPIOTE_CONFIG_OUT_TASK_TOGGLE(false);
+
+    if (nrfx_gpiote_out_init(OUT_PIN, &cfg) != NRFX_SUCCESS ||
+        nrfx_ppi_channel_alloc(&ppi_gen) != NRFX_SUCCESS ||
+        nrfx_ppi_channel_alloc(&ppi_burst) != NRFX_SUCCESS) {
+        return -EBUSY;
+    }
+
+    nrf_timer_mode_set(GEN_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(GEN_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_frequency_set(GEN_TIMER, NRF_TIMER_FREQ_16MHz);
+    nrf_timer_shorts_enable(GEN_TIMER, NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK);
+
+    nrf_timer_mode_set(BURST_TIMER, NRF_TIMER_MODE_LOW_POWER_COUNTER);
+    nrf_timer_bit_width_set(BURST_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_shorts_enable(BURST_TIMER, NRF_TIMER_SHORT_COMPARE0_STOP_MASK);
+
+    nrfx_ppi_channel_assign(ppi_gen,
+        nrf_timer_event_address_get(GEN_TIMER, NRF_TIMER_EVENT_COMPARE0),
+        nrfx_gpiote_out_task_addr_get(OUT_PIN));
+    nrfx_ppi_channel_fork_assign(ppi_gen,
+        nrf_timer_task_address_get(BURST_TIMER, NRF_TIMER_TASK_COUNT));
+    nrfx_ppi_channel_assign(ppi_burst,
+        nrf_timer_event_address_get(BURST_TIMER, NRF_TIMER_EVENT_COMPARE0),
+        nrf_timer_task_address_get(GEN_TIMER, NRF_TIMER_TASK_STOP));
+    nrfx_ppi_channel_enable(ppi_gen);
+    nrfx_ppi_channel_enable(ppi_burst);
+    nrfx_gpiote_out_task_enable(OUT_PIN);
+
+    return 0;
+}
+
+static void gen_deinit(void)
+{
+    nrfx_gpiote_out_task_disable(OUT_PIN);
+    nrfx_ppi_channel_disable(ppi_gen);
+    nrfx_ppi_channel_disable(ppi_burst);
+    nrfx_ppi_channel_free(ppi_gen);
+    nrfx_ppi_channel_free(ppi_burst);
+    nrfx_gpiote_out_uninit(OUT_PIN);
+}
+
+/* Generate "edges" rising edges at "rate" and return how many were counted */
+static uint32_t gen_burst(uint32_t rate, uint32_t edges)
+{
+    nrf_timer_task_trigger(GEN_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_task_trigger(BURST_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_cc_set(GEN_TIMER, NRF_TIMER_CC_CHANNEL0, GEN_TIMER_HZ / (2 * rate));
+    nrf_timer_cc_set(BURST_TIMER, NRF_TIMER_CC_CHANNEL0, 2 * edges);
+    nrf_timer_event_clear(BURST_TIMER, NRF_TIMER_EVENT_COMPARE0);
+
+    nrf_timer_task_trigger(BURST_TIMER, NRF_TIMER_TASK_START);
+    nrf_timer_task_trigger(GEN_TIMER, NRF_TIMER_TASK_START);
+
+    /* The ISR path may starve this thread while the burst runs; it resumes
+     * once the generator has stopped and the interrupt backlog drained */
+    do {
+        k_msleep(BURST_MS);
+    } while (!nrf_timer_event_check(BURST_TIMER, NRF_TIMER_EVENT_COMPARE0));
+    k_msleep(1);
+
+    return edge_count_read();
+}
+
+static void bench_path(enum edge_count_path path, const char *name)
+{
+    uint32_t max_ok = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(rates); i++) {
+        uint32_t edges = rates[i] / (MSEC_PER_SEC / BURST_MS);
+        uint32_t counted;
+
+        if (edge_count_start(path) != 0) {
+            printk("  %s: failed to start\n\r", name);
+            return;
+        }
+        counted = gen_burst(rates[i], edges);
+        edge_count_stop();
+
+        printk("  %s %7u edges/s: %u/%u\n\r", name, rates[i], counted, edges);
+        if (counted != edges) {
+            break;
+        }
+        max_ok = rates[i];
+    }
+
+    printk("  %s: max sustainable rate %u edges/s%s\n\r", name, max_ok,
+           max_ok == rates[ARRAY_SIZE(rates) - 1] ? " (or more)" : "");
+}
+
+void edge_count_bench_run(void)
+{
+    printk("Edge count bench: wire P0.%02d to P0.%02d\n\r",
+           OUT_PIN, CONFIG_APP_EDGE_COUNT_PIN);
+
+    if (gen_init() != 0) {
+        printk("Error: edge generator setup failed\n\r");
+        return;
+    }
+
+    bench_path(EDGE_COUNT_ISR, "isr");
+    bench_path(EDGE_COUNT_HW, "hw");
+
+    gen_deinit();
+}
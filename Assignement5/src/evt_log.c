@@ -0,0 +1,188 @@
+/*
+ * Post-mortem event ring
+ *
+ * The ring lives in .noinit, so it is not zeroed at boot; a magic word
+ * tells a retained ring from power-on garbage. The head index counts
+ * events and is only used masked, so any retained value stays in bounds.
+ * Entries are 8 bytes and written with interrupts locked, so a reset can
+ * at worst lose the event being written.
+ *
+ * The fatal error handler copies the exception frame and the fault status
+ * registers into the same region and reboots; the snapshot is printed and
+ * cleared on the next boot.
+ *
+ * Output goes through uart_poll_out() with a minimal hex formatter, so the
+ * release profile (no printk, no console) can still dump it.
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/uart.h>
+#include <fatal.h>
+#include <sys/reboot.h>
+#include <soc.h>
+#include <string.h>
+#include <hal/nrf_power.h>
+
+#include "evt_log.h"
+
+#define EVT_LOG_MAGIC 0x45564c31    /* "EVL1" */
+#define RING_SIZE CONFIG_APP_EVT_LOG_SIZE
+#define RING_MASK (RING_SIZE - 1)
+
+BUILD_ASSERT((RING_SIZE & RING_MASK) == 0, "Ring size must be a power of two");
+
+struct evt {
+    uint32_t uptime_ms;
+    uint16_t id;
+    uint16_t arg;
+};
+
+struct evt_fault {
+    uint32_t valid;
+    uint32_t reason;
+    uint32_t r0, r1, r2, r3, r12, lr, pc, xpsr;
+    uint32_t cfsr, hfsr, mmfar, bfar;
+};
+
+struct evt_ring {
+    uint32_t magic;
+    uint32_t head;          /* Total events written (index = head & mask) */
+    uint32_t boots;
+    struct evt_fault fault;
+    struct evt evt[RING_SIZE];
+};
+
+static __noinit struct evt_ring ring;
+
+static const struct device *uart_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
+
+static void out_str(const char *s)
+{
+    while (*s) {
+        uart_poll_out(uart_dev, *s++);
+    }
+}
+
+static void out_hex(uint32_t v, int digits)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    while (digits--) {
+        uart_poll_out(uart_dev, hex[(v >> (4 * digits)) & 0xf]);
+    }
+}
+
+static void out_reg(const char *name, uint32_t v)
+{
+    out_str(" ");
+    out_str(name);
+    out_str("=");
+    out_hex(v, 8);
+}
+
+void evt_log(enum evt_id id, uint16_t arg)
+{
+    unsigned int key = irq_lock();
+    struct evt *e = &ring.evt[ring.head & RING_MASK];
+
+    e->uptime_ms = k_uptime_get_32();
+    e->id = (uint16_t)id;
+    e->arg = arg;
+    ring.head++;
+    irq_unlock(key);
+}
+
+void evt_log_dump(void)
+{
+    uint32_t n = MIN(ring.head, (uint32_t)RING_SIZE);
+
+    if (!device_is_ready(uart_dev)) {
+        return;
+    }
+
+    out_str("EVT boots=");
+    out_hex(ring.boots, 8);
+    out_str(" events=");
+    out_hex(ring.head, 8);
+    out_str("\r\n");
+
+    if (ring.fault.valid) {
+        const struct evt_fault *f = &ring.fault;
+
+        out_str("EVT fault");
+        out_reg("reason", f->reason);
+        out_reg("pc", f->pc);
+        out_reg("lr", f->lr);
+        out_reg("xpsr", f->xpsr);
+        out_reg("r0", f->r0);
+        out_reg("r1", f->r1);
+        out_reg("r2", f->r2);
+        out_reg("r3", f->r3);
+        out_reg("r12", f->r12);
+        out_reg("cfsr", f->cfsr);
+        out_reg("hfsr", f->hfsr);
+        out_reg("mmfar", f->mmfar);
+        out_reg("bfar", f->bfar);
+        out_str("\r\n");
+    }
+
+    /* Oldest first */
+    for (uint32_t i = ring.head - n; i != ring.head; i++) {
+        const struct evt *e = &ring.evt[i & RING_MASK];
+
+        out_str("EVT ");
+        out_hex(e->uptime_ms, 8);
+        out_str(" ");
+        out_hex(e->id, 4);
+        out_str(" ");
+        out_hex(e->arg, 4);
+        out_str("\r\n");
+    }
+}
+
+void evt_log_init(void)
+{
+    uint32_t resetreas = nrf_power_resetreas_get(NRF_POWER);
+
+    if (ring.magic != EVT_LOG_MAGIC) {
+        memset(&ring, 0, sizeof(ring));
+        ring.magic = EVT_LOG_MAGIC;
+    } else {
+        evt_log_dump();
+    }
+
+    ring.fault.valid = 0;
+    ring.boots++;
+    nrf_power_resetreas_clear(NRF_POWER, resetreas);
+    evt_log(EVT_BOOT, (uint16_t)resetreas);
+}
+
+void k_sys_fatal_error_handler(unsigned int reason, const z_arch_esf_t *esf)
+{
+    struct evt_fault *f = &ring.fault;
+
+    irq_lock();
+
+    f->reason = reason;
+    if (esf != NULL) {
+        f->r0 = esf->basic.a1;
+        f->r1 = esf->basic.a2;
+        f->r2 = esf->basic.a3;
+        f->r3 = esf->basic.a4;
+        f->r12 = esf->basic.ip;
+        f->lr = esf->basic.lr;
+        f->pc = esf->basic.pc;
+        f->xpsr = esf->basic.xpsr;
+    }
+    f->cfsr = SCB->CFSR;
+    f->hfsr = SCB->HFSR;
+    f->mmfar = SCB->MMFAR;
+    f->bfar = SCB->BFAR;
+    f->valid = 1;
+    evt_log(EVT_FAULT, (uint16_t)reason);
+
+    /* RAM is retained over a system reset */
+    sys_reboot(SYS_REBOOT_WARM);
+}
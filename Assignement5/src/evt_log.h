@@ -0,0 +1,35 @@
+/*
+ * Post-mortem event ring
+ *
+ * The last CONFIG_APP_EVT_LOG_SIZE events (uptime, id, argument) are kept
+ * in a noinit RAM region that survives a reset, together with a register
+ * snapshot taken by the fatal error handler. evt_log_init() dumps both on
+ * the next boot, directly on the console UART so it works in builds
+ * without printk.
+ */
+
+#ifndef EVT_LOG_H
+#define EVT_LOG_H
+
+#include <zephyr/types.h>
+
+enum evt_id {
+    EVT_BOOT = 1,       /* arg: reset reason (RESETREAS, low 16 bits) */
+    EVT_FAULT,          /* arg: fatal error reason */
+    EVT_BUTTON,         /* arg: button (1..4), | gesture << 8 (APP_GESTURE) */
+    EVT_DUTY,           /* arg: duty-cycle (permille) */
+    EVT_CLOCK_SET,      /* arg: minute of day */
+    EVT_CMD_ERR,        /* arg: -errno */
+};
+
+/* Validate the ring, dump the previous boots' events and fault (if any),
+ * and log EVT_BOOT. Call first thing in main() */
+void evt_log_init(void);
+
+/* Append an event. ISR safe, constant time */
+void evt_log(enum evt_id id, uint16_t arg);
+
+/* Dump the ring on the console UART */
+void evt_log_dump(void);
+
+#endif /* EVT_LOG_H */
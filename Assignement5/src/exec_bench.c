@@ -0,0 +1,119 @@
+/*
+ * Execution mode statistics
+ *
+ * Context switches are counted through the user tracing hooks
+ * (CONFIG_TRACING_USER). Latencies use the timing counter; only the input
+ * path is stamped in ISR context, everything else runs in the handlers.
+ * Build with -DOVERLAY_CONFIG=overlay-exec-bench.conf, optionally together
+ * with overlay-workq.conf, to compare both modes.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <sys/atomic.h>
+#include <timing/timing.h>
+#include <string.h>
+#include <tracing_user.h>
+
+#include "exec_bench.h"
+
+struct lat_stats {
+    uint32_t n;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+};
+
+static atomic_t ctx_switches;
+static timing_t input_stamp;
+static volatile bool input_pending;
+static struct lat_stats input_lat;      /* ns, ISR entry to handler */
+static struct lat_stats tick_late;      /* us, release instant to tick */
+static uint32_t ticks;
+static bool timing_ready;
+
+void sys_trace_thread_switched_in_user(struct k_thread *thread)
+{
+    atomic_inc(&ctx_switches);
+}
+
+static void lat_add(struct lat_stats *s, uint64_t v)
+{
+    if (s->n == 0 || v < s->min) {
+        s->min = v;
+    }
+    if (v > s->max) {
+        s->max = v;
+    }
+    s->sum += v;
+    s->n++;
+}
+
+static void lat_print(const char *name, const char *unit, struct lat_stats *s)
+{
+    if (s->n == 0) {
+        printk("  %s: no samples\n\r", name);
+    } else {
+        printk("  %s: min %llu avg %llu max %llu %s (%u samples)\n\r", name,
+               s->min, s->sum / s->n, s->max, unit, s->n);
+    }
+    memset(s, 0, sizeof(*s));
+}
+
+static void stack_print(const struct k_thread *cthread, void *user_data)
+{
+    struct k_thread *thread = (struct k_thread *)cthread;
+    size_t unused = 0;
+    const char *name = k_thread_name_get(thread);
+
+    k_thread_stack_space_get(thread, &unused);
+    printk("  stack %-10s size %u used %u\n\r", name ? name : "?",
+           thread->stack_info.size, thread->stack_info.size - unused);
+}
+
+void exec_bench_input_stamp(void)
+{
+    if (timing_ready) {
+        input_stamp = timing_counter_get();
+        input_pending = true;
+    }
+}
+
+void exec_bench_input_handled(void)
+{
+    timing_t now;
+
+    if (!input_pending) {
+        return;
+    }
+    now = timing_counter_get();
+    input_pending = false;
+    lat_add(&input_lat, timing_cycles_to_ns(timing_cycles_get(&input_stamp, &now)));
+}
+
+void exec_bench_tick(int64_t release_ms)
+{
+    int64_t late_us = k_ticks_to_us_floor64(k_uptime_ticks()) - release_ms * USEC_PER_MSEC;
+
+    if (!timing_ready) {
+        timing_init();
+        timing_start();
+        timing_ready = true;
+    }
+
+    lat_add(&tick_late, late_us > 0 ? late_us : 0);
+
+    if (++ticks < CONFIG_APP_EXEC_BENCH_PERIOD_S) {
+        return;
+    }
+    ticks = 0;
+
+    printk("exec bench (%s mode%s):\n\r",
+           IS_ENABLED(CONFIG_APP_EXEC_WORKQ) ? "work queue" : "threaded",
+           IS_ENABLED(CONFIG_APP_CLOCK_TIMER) ? ", timer tick" : "");
+    printk("  context switches: %lu /s\n\r",
+           (unsigned long)atomic_clear(&ctx_switches) / CONFIG_APP_EXEC_BENCH_PERIOD_S);
+    lat_print("input latency", "ns", &input_lat);
+    lat_print("tick lateness", "us", &tick_late);
+    k_thread_foreach(stack_print, NULL);
+}
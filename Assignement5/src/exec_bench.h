@@ -0,0 +1,23 @@
+/*
+ * Execution mode statistics
+ *
+ * Compares the threaded and the single work queue execution modes:
+ * context switches per second, button-to-handler latency, clock tick
+ * release lateness and stack usage, printed every APP_EXEC_BENCH_PERIOD_S.
+ */
+
+#ifndef EXEC_BENCH_H
+#define EXEC_BENCH_H
+
+#include <zephyr/types.h>
+
+/* Button interrupt entry (ISR context) */
+void exec_bench_input_stamp(void);
+
+/* Button event picked up by its handler */
+void exec_bench_input_handled(void);
+
+/* Clock tick executed; "release_ms" is the uptime it was due at */
+void exec_bench_tick(int64_t release_ms);
+
+#endif /* EXEC_BENCH_H */
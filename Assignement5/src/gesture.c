@@ -0,0 +1,272 @@
+/*
+ * Button gesture recognizer
+ *
+ * Each button is a small state machine fed by its debounced edges, which
+ * carry the timestamp of the first raw edge of the transition, and by at
+ * most one deadline (long press, double press window or next repeat).
+ * One k_timer serves every button: after each event it is re-armed, as an
+ * absolute timeout, at the earliest deadline, or stopped if there is none.
+ *
+ * An edge that arrives after a deadline whose expiry has not been handled
+ * yet first completes the gesture of that deadline, so the result only
+ * depends on the timestamps, not on the order the ISRs happened to run.
+ * Debounced edges reach us THRESHOLD samples after their raw timestamp,
+ * so the timer leaves a button alone while its input is settling and
+ * looks again one sample later: the pending edge, which may precede the
+ * deadline, is then handled first.
+ *
+ * Every event handles one button (edge) or the expired buttons (timer),
+ * then rescans the deadlines: its cost is bounded by
+ * APP_GESTURE_MAX_BUTTONS state updates, and measured.
+ */
+
+#include <zephyr.h>
+#include <spinlock.h>
+#include <sys/printk.h>
+#include <errno.h>
+
+#include "gesture.h"
+#include "debounce.h"
+
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+#include "dwt.h"
+#endif
+
+#define MAX_BUTTONS CONFIG_APP_GESTURE_MAX_BUTTONS
+
+#define NO_DEADLINE INT64_MAX
+
+enum gesture_state {
+    G_IDLE,
+    G_DOWN,         /* Pressed, long press deadline pending */
+    G_UP,           /* Short press released, double press window open */
+    G_HOLD,         /* Long press reported, repeat deadline pending */
+    G_DONE,         /* Gesture reported, waiting for the release */
+};
+
+struct gesture_button {
+    struct debounce_input in;
+    enum gesture_state state;
+    uint32_t options;
+    int64_t deadline;       /* Uptime ticks, or NO_DEADLINE */
+};
+
+static struct gesture_button buttons[MAX_BUTTONS];
+static int n_buttons;
+static gesture_cb_t gesture_cb;
+
+static struct k_spinlock gesture_lock;
+static int64_t armed = NO_DEADLINE;     /* Deadline the timer is armed at */
+static struct gesture_stats stats;
+
+static void gesture_expiry(struct k_timer *timer);
+static K_TIMER_DEFINE(gesture_timer, gesture_expiry, NULL);
+
+static inline uint32_t cost_start(void)
+{
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+    return dwt_cycles();
+#else
+    return k_cycle_get_32();
+#endif
+}
+
+static void cost_end(uint32_t start)
+{
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+    uint32_t ns = dwt_cycles_to_ns(dwt_cycles() - start);
+#else
+    uint32_t ns = (uint32_t)k_cyc_to_ns_floor64(k_cycle_get_32() - start);
+#endif
+
+    stats.events++;
+    stats.cost_sum_ns += ns;
+    if (ns > stats.cost_max_ns) {
+        stats.cost_max_ns = ns;
+    }
+}
+
+/* Report "g" of "b", decided at "decided" (ticks) */
+static void emit(struct gesture_button *b, enum gesture g, int64_t decided)
+{
+    int64_t late = k_uptime_ticks() - decided;
+    uint32_t us = (late > 0) ? (uint32_t)k_ticks_to_us_floor64(late) : 0;
+
+    stats.count[g]++;
+    if (us > stats.late_max_us) {
+        stats.late_max_us = us;
+    }
+    gesture_cb((int)(b - buttons), g);
+}
+
+/* Arm the shared timer at the earliest deadline, but not before
+ * "not_before". Called with the lock held */
+static void rearm(int64_t not_before)
+{
+    int64_t next = NO_DEADLINE;
+
+    for (int i = 0; i < n_buttons; i++) {
+        next = MIN(next, buttons[i].deadline);
+    }
+    if (next != NO_DEADLINE) {
+        next = MAX(next, not_before);
+    }
+    if (next == armed) {
+        return;
+    }
+    armed = next;
+    if (next == NO_DEADLINE) {
+        k_timer_stop(&gesture_timer);
+    } else {
+        k_timer_start(&gesture_timer, K_TIMEOUT_ABS_TICKS(next), K_NO_WAIT);
+    }
+}
+
+/* The deadline of "b" has passed */
+static void expire(struct gesture_button *b)
+{
+    int64_t t = b->deadline;
+
+    switch (b->state) {
+    case G_DOWN:
+        emit(b, GESTURE_LONG, t);
+        b->state = G_HOLD;
+        b->deadline = t + k_ms_to_ticks_ceil64(CONFIG_APP_GESTURE_REPEAT_MS);
+        break;
+    case G_HOLD:
+        emit(b, GESTURE_REPEAT, t);
+        b->deadline = t + k_ms_to_ticks_ceil64(CONFIG_APP_GESTURE_REPEAT_MS);
+        break;
+    case G_UP:
+        emit(b, GESTURE_SHORT, t);
+        b->state = G_IDLE;
+        b->deadline = NO_DEADLINE;
+        break;
+    default:
+        b->deadline = NO_DEADLINE;
+        break;
+    }
+}
+
+static void gesture_expiry(struct k_timer *timer)
+{
+    uint32_t start = cost_start();
+    k_spinlock_key_t key = k_spin_lock(&gesture_lock);
+    int64_t now = k_uptime_ticks();
+    int64_t not_before = 0;
+
+    armed = NO_DEADLINE;
+    for (int i = 0; i < n_buttons; i++) {
+        if (buttons[i].deadline > now) {
+            continue;
+        }
+        if (debounce_settling(&buttons[i].in)) {
+            /* Its edge is on the way, and may precede the deadline */
+            not_before = now + k_ms_to_ticks_ceil64(CONFIG_APP_DEBOUNCE_SAMPLE_MS);
+            continue;
+        }
+        expire(&buttons[i]);
+    }
+    rearm(not_before);
+    cost_end(start);
+    k_spin_unlock(&gesture_lock, key);
+}
+
+static void press(struct gesture_button *b, int64_t t)
+{
+    if (b->state == G_UP && t < b->deadline) {
+        emit(b, GESTURE_DOUBLE, t);
+        b->state = G_DONE;
+        b->deadline = NO_DEADLINE;
+        return;
+    }
+    b->state = G_DOWN;
+    b->deadline = t + k_ms_to_ticks_ceil64(CONFIG_APP_GESTURE_LONG_MS);
+}
+
+static void release(struct gesture_button *b, int64_t t)
+{
+    if (b->state != G_DOWN) {
+        b->state = G_IDLE;
+        b->deadline = NO_DEADLINE;
+    } else if (b->options & GESTURE_OPT_DOUBLE) {
+        b->state = G_UP;
+        b->deadline = t + k_ms_to_ticks_ceil64(CONFIG_APP_GESTURE_DOUBLE_MS);
+    } else {
+        emit(b, GESTURE_SHORT, t);
+        b->state = G_IDLE;
+        b->deadline = NO_DEADLINE;
+    }
+}
+
+/* Debounced edge, from the debounce sampling timer */
+static void gesture_edge(struct debounce_input *in, bool active)
+{
+    struct gesture_button *b = CONTAINER_OF(in, struct gesture_button, in);
+    uint32_t start = cost_start();
+    k_spinlock_key_t key = k_spin_lock(&gesture_lock);
+    int64_t t = in->edge_ticks;
+
+    /* Complete a gesture whose deadline precedes this edge */
+    while (b->deadline <= t) {
+        expire(b);
+    }
+    if (active) {
+        press(b, t);
+    } else {
+        release(b, t);
+    }
+    rearm(0);
+    cost_end(start);
+    k_spin_unlock(&gesture_lock, key);
+}
+
+void gesture_init(gesture_cb_t cb)
+{
+    gesture_cb = cb;
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+    dwt_init();
+#endif
+}
+
+int gesture_add(const struct device *port, gpio_pin_t pin, uint32_t options)
+{
+    struct gesture_button *b;
+    int ret;
+
+    if (n_buttons == MAX_BUTTONS) {
+        return -ENOMEM;
+    }
+    b = &buttons[n_buttons];
+    b->state = G_IDLE;
+    b->options = options;
+    b->deadline = NO_DEADLINE;
+
+    ret = debounce_add(&b->in, port, pin, CONFIG_APP_DEBOUNCE_THRESHOLD, gesture_edge);
+    if (ret != 0) {
+        return ret;
+    }
+
+    return n_buttons++;
+}
+
+void gesture_stats_get(struct gesture_stats *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&gesture_lock);
+
+    *out = stats;
+    k_spin_unlock(&gesture_lock, key);
+}
+
+void gesture_dump(void)
+{
+    struct gesture_stats s;
+
+    gesture_stats_get(&s);
+    printk("gesture: %u short, %u long, %u double, %u repeat\n\r",
+           s.count[GESTURE_SHORT], s.count[GESTURE_LONG],
+           s.count[GESTURE_DOUBLE], s.count[GESTURE_REPEAT]);
+    printk("    late max %u us, cost max %u ns avg %u ns over %u events\n\r",
+           s.late_max_us, s.cost_max_ns,
+           (s.events > 0) ? s.cost_sum_ns / s.events : 0, s.events);
+}
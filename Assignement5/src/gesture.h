@@ -0,0 +1,63 @@
+/*
+ * Button gesture recognizer
+ *
+ * Classifies the debounced press/release stream of up to
+ * APP_GESTURE_MAX_BUTTONS buttons into gestures:
+ *  - short press: released before APP_GESTURE_LONG_MS, and not followed by
+ *    a second press within APP_GESTURE_DOUBLE_MS (if double press is
+ *    enabled for the button, else reported at the release)
+ *  - double press: second press within APP_GESTURE_DOUBLE_MS of the
+ *    release of a short press, reported at the second press
+ *  - long press: held for APP_GESTURE_LONG_MS
+ *  - repeat: every APP_GESTURE_REPEAT_MS while still held after a long press
+ * Durations are measured between the raw edge timestamps, so debouncing
+ * delays the recognition but does not skew the classification. All
+ * buttons share one k_timer, armed at the earliest pending deadline.
+ */
+
+#ifndef GESTURE_H
+#define GESTURE_H
+
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/gpio.h>
+
+enum gesture {
+    GESTURE_SHORT,
+    GESTURE_LONG,
+    GESTURE_DOUBLE,
+    GESTURE_REPEAT,
+    GESTURE_TYPES
+};
+
+/* Recognized gesture of button "button" (the index returned by
+ * gesture_add()). Called in ISR context */
+typedef void (*gesture_cb_t)(int button, enum gesture gesture);
+
+/* Button options */
+#define GESTURE_OPT_DOUBLE  BIT(0)      /* Recognize double presses */
+
+struct gesture_stats {
+    uint32_t count[GESTURE_TYPES];  /* Gestures reported, by type */
+    uint32_t late_max_us;           /* Worst report time past the deciding
+                                     * edge or deadline */
+    uint32_t cost_max_ns;           /* Worst CPU time of one event */
+    uint32_t cost_sum_ns;           /* ... summed, for the average */
+    uint32_t events;                /* Edges and deadlines handled */
+};
+
+/* Set the gesture callback. Must precede gesture_add() */
+void gesture_init(gesture_cb_t cb);
+
+/* Debounce "pin" of "port" (already configured as an input) and recognize
+ * its gestures. Returns the button index, -ENOMEM if all buttons are in
+ * use, or a debounce error */
+int gesture_add(const struct device *port, gpio_pin_t pin, uint32_t options);
+
+/* Copy the statistics */
+void gesture_stats_get(struct gesture_stats *stats);
+
+/* Print the statistics */
+void gesture_dump(void);
+
+#endif /* GESTURE_H */
@@ -0,0 +1,23 @@
+/*
+ * Hot-path code placement
+ *
+ * Functions on the latency-critical paths (GPIO/button callbacks, PWM
+ * update, clock tick) are tagged APP_HOT. With CONFIG_APP_RAMFUNC they are
+ * linked into the .ramfunc section and run from RAM without flash wait
+ * states; otherwise the tag is empty. Kernel and driver functions they
+ * call still run from flash unless relocated as well.
+ */
+
+#ifndef HOT_H
+#define HOT_H
+
+#include <toolchain.h>
+#include <linker/section_tags.h>
+
+#if defined(CONFIG_APP_RAMFUNC)
+#define APP_HOT __ramfunc
+#else
+#define APP_HOT
+#endif
+
+#endif /* HOT_H */
@@ -0,0 +1,195 @@
+/*
+ * Hot-path placement benchmark
+ *
+ * Measures the hot paths in CPU cycles (DWT), once with the NVMC
+ * instruction cache disabled and once enabled, in whatever placement the
+ * image was built with (CONFIG_APP_RAMFUNC on or off):
+ *  - gpio isr:   software edge on a pin wired to itself (input buffer
+ *                connected while driven) to callback entry, i.e. GPIOTE
+ *                interrupt entry plus GPIO driver dispatch
+ *  - pwm update: pwm_out_set_duty()
+ *  - clock tick: clock_tick()
+ * The first run of each path ("cold") is reported apart from the minimum
+ * and average of the following runs. Runs in a low-priority thread once
+ * the application is up; the clock and the LED are put back afterwards.
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/gpio.h>
+#include <sys/printk.h>
+#include <linker/linker-defs.h>
+#include <hal/nrf_nvmc.h>
+
+#include "hot.h"
+#include "dwt.h"
+#include "clock.h"
+#include "pwm_out.h"
+
+#define GPIO0_NID DT_NODELABEL(gpio0)
+#define BENCH_PIN CONFIG_APP_HOT_BENCH_PIN
+#define BENCH_LED_PIN 0xe           /* Same LED as the manual control */
+#define BENCH_RUNS 100
+#define BENCH_STACK_SIZE 1024
+#define BENCH_PRIO 2                /* Below the application threads */
+#define BENCH_START_MS 3000
+#define BENCH_GPIO_TIMEOUT_CYCLES 640000    /* 10 ms at 64 MHz */
+
+struct bench_result {
+    uint32_t cold;
+    uint32_t min;
+    uint64_t sum;
+};
+
+static const struct device *gpio0_dev;
+static struct gpio_callback bench_cb_data;
+static volatile uint32_t t_cb;
+static uint32_t gpio_timeouts;
+
+static APP_HOT void bench_cb(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+    t_cb = dwt_cycles();
+}
+
+static void result_add(struct bench_result *r, int run, uint32_t cycles)
+{
+    if (run == 0) {
+        r->cold = cycles;
+        r->min = UINT32_MAX;
+        r->sum = 0;
+        return;
+    }
+    r->min = MIN(r->min, cycles);
+    r->sum += cycles;
+}
+
+static void result_print(const char *name, const struct bench_result *r)
+{
+    printk("  %-11s cold %6u  min %6u  avg %6u cycles\n\r", name, r->cold, r->min,
+           (uint32_t)(r->sum / (BENCH_RUNS - 1)));
+}
+
+static uint32_t bench_gpio(void)
+{
+    uint32_t t0;
+
+    gpio_pin_set(gpio0_dev, BENCH_PIN, 0);
+    k_busy_wait(10);
+    t_cb = 0;
+    t0 = dwt_cycles();
+    gpio_pin_set(gpio0_dev, BENCH_PIN, 1);
+    while (t_cb == 0) {
+        if (dwt_cycles() - t0 > BENCH_GPIO_TIMEOUT_CYCLES) {
+            gpio_timeouts++;
+            return BENCH_GPIO_TIMEOUT_CYCLES;
+        }
+    }
+
+    return t_cb - t0;
+}
+
+static uint32_t bench_pwm(int run)
+{
+    uint32_t t0, t1;
+
+    /* Let the previous update load, so only the code path is measured.
+     * Both duty-cycles are intermediate, so that no run takes a 0% or
+     * 100% special case */
+    k_msleep(2);
+    t0 = dwt_cycles();
+    pwm_out_set_duty(BENCH_LED_PIN, (run & 1) ? 750 : 250);
+    t1 = dwt_cycles();
+
+    return t1 - t0;
+}
+
+static uint32_t bench_clock(void)
+{
+    unsigned int key = irq_lock();
+    uint32_t t0, t1;
+
+    t0 = dwt_cycles();
+    clock_tick();
+    t1 = dwt_cycles();
+    irq_unlock(key);
+
+    return t1 - t0;
+}
+
+static void bench_all(const char *cache)
+{
+    struct bench_result gpio, pwm, clk;
+    uint32_t hit, miss;
+    int duty = pwm_out_get_duty(BENCH_LED_PIN);
+
+    nrf_nvmc_icache_hit_miss_reset(NRF_NVMC);
+
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        result_add(&gpio, i, bench_gpio());
+    }
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        result_add(&pwm, i, bench_pwm(i));
+    }
+    /* Back to the level the manual control last set and displayed */
+    if (duty >= 0) {
+        pwm_out_set_duty(BENCH_LED_PIN, (uint16_t)duty);
+    }
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        result_add(&clk, i, bench_clock());
+    }
+
+    hit = nrf_nvmc_icache_hit_get(NRF_NVMC);
+    miss = nrf_nvmc_icache_miss_get(NRF_NVMC);
+
+    printk(" icache %s (hits %u, misses %u):\n\r", cache, hit, miss);
+    result_print("gpio isr", &gpio);
+    if (gpio_timeouts) {
+        printk("  gpio isr: %u edges without callback\n\r", gpio_timeouts);
+        gpio_timeouts = 0;
+    }
+    result_print("pwm update", &pwm);
+    result_print("clock tick", &clk);
+}
+
+static void hot_bench_thread_code(void *argA, void *argB, void *argC)
+{
+    uint32_t icachecnf = NRF_NVMC->ICACHECNF;
+    uint32_t epoch;
+    int64_t start_ms;
+
+    dwt_init();
+
+    gpio0_dev = device_get_binding(DT_LABEL(GPIO0_NID));
+    if (gpio0_dev == NULL ||
+        gpio_pin_configure(gpio0_dev, BENCH_PIN, GPIO_INPUT | GPIO_OUTPUT_LOW) != 0) {
+        printk("Error: hot bench failed to configure P0.%02d\n\r", BENCH_PIN);
+        return;
+    }
+    gpio_init_callback(&bench_cb_data, bench_cb, BIT(BENCH_PIN));
+    gpio_add_callback(gpio0_dev, &bench_cb_data);
+    gpio_pin_interrupt_configure(gpio0_dev, BENCH_PIN, GPIO_INT_EDGE_RISING);
+
+    printk("Hot path bench (%s, .ramfunc %u bytes):\n\r",
+           IS_ENABLED(CONFIG_APP_RAMFUNC) ? "hot paths in RAM" : "all code in flash",
+           (uint32_t)(__ramfunc_end - __ramfunc_start));
+
+    /* clock_tick() runs advance the clock: put it back afterwards, plus
+     * the time the bench took (to the nearest second) */
+    epoch = clock_get_epoch();
+    start_ms = k_uptime_get();
+
+    nrf_nvmc_icache_config_set(NRF_NVMC, NRF_NVMC_ICACHE_DISABLE);
+    bench_all("off");
+    nrf_nvmc_icache_config_set(NRF_NVMC, NRF_NVMC_ICACHE_ENABLE_WITH_PROFILING);
+    bench_all("on");
+
+    NRF_NVMC->ICACHECNF = icachecnf;
+    clock_set_epoch(epoch + (uint32_t)((k_uptime_get() - start_ms + 500) / MSEC_PER_SEC));
+
+    gpio_pin_interrupt_configure(gpio0_dev, BENCH_PIN, GPIO_INT_DISABLE);
+    gpio_remove_callback(gpio0_dev, &bench_cb_data);
+}
+
+K_THREAD_DEFINE(hot_bench_thread, BENCH_STACK_SIZE, hot_bench_thread_code,
+                NULL, NULL, NULL, BENCH_PRIO, 0, BENCH_START_MS);
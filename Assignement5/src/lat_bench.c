@@ -0,0 +1,161 @@
+/*
+ * GPIO loopback interrupt-latency benchmark
+ *
+ * Wire APP_LAT_BENCH_OUT_PIN (P0.03 by default, Arduino A0) to BUT1 (P0.11).
+ * The benchmark thread drives the pin low, lets it settle, reads CYCCNT
+ * and drives it high, which is the edge BUT1 interrupts on. It then waits
+ * for the manual handler to stamp its wake-up before the next sample.
+ *
+ * Latencies are accumulated in fixed-width histograms, so memory does not
+ * grow with the number of samples; percentiles are read from the buckets.
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/gpio.h>
+#include <sys/printk.h>
+
+#include "lat_bench.h"
+#include "dwt.h"
+
+#define GPIO0_NID DT_NODELABEL(gpio0)
+
+#define LAT_BENCH_STACK_SIZE 1024
+#define LAT_BENCH_PRIO 2            /* Below the application threads */
+#define LAT_BENCH_START_MS 2000     /* Let the application configure BUT1 */
+#define LAT_BENCH_SETTLE_US 200     /* Low time between stimuli */
+
+#define HIST_BUCKETS 128
+#define HIST_WIDTH CONFIG_APP_LAT_BENCH_BUCKET_CYCLES
+
+struct lat_hist {
+    uint32_t bucket[HIST_BUCKETS + 1];  /* Last bucket collects overflows */
+    uint32_t n;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+};
+
+static struct lat_hist edge_to_isr;
+static struct lat_hist isr_to_thread;
+static struct lat_hist end_to_end;
+
+static volatile uint32_t t_isr;
+static volatile uint32_t t_thread;
+static volatile bool armed;
+static K_SEM_DEFINE(woken, 0, 1);
+
+void lat_bench_stamp_isr(void)
+{
+    if (armed) {
+        t_isr = dwt_cycles();
+    }
+}
+
+void lat_bench_stamp_thread(void)
+{
+    if (armed) {
+        t_thread = dwt_cycles();
+        armed = false;
+        k_sem_give(&woken);
+    }
+}
+
+static void hist_add(struct lat_hist *h, uint32_t cycles)
+{
+    uint32_t b = MIN(cycles / HIST_WIDTH, (uint32_t)HIST_BUCKETS);
+
+    h->bucket[b]++;
+    if (h->n == 0 || cycles < h->min) {
+        h->min = cycles;
+    }
+    if (cycles > h->max) {
+        h->max = cycles;
+    }
+    h->sum += cycles;
+    h->n++;
+}
+
+/* Upper edge (ns) of the bucket holding the "pm" permille sample */
+static uint32_t hist_percentile(const struct lat_hist *h, uint32_t pm)
+{
+    uint32_t target = (uint32_t)(((uint64_t)h->n * pm + 999) / 1000);
+    uint32_t acc = 0;
+
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        acc += h->bucket[b];
+        if (acc >= target) {
+            return dwt_cycles_to_ns((b + 1) * HIST_WIDTH);
+        }
+    }
+
+    return dwt_cycles_to_ns(h->max);
+}
+
+static void hist_print(const char *name, const struct lat_hist *h)
+{
+    if (h->n == 0) {
+        printk("  %-14s no samples\n\r", name);
+        return;
+    }
+    printk("  %-14s min %u avg %u p50 %u p90 %u p99 %u max %u ns\n\r", name,
+           dwt_cycles_to_ns(h->min), dwt_cycles_to_ns((uint32_t)(h->sum / h->n)),
+           hist_percentile(h, 500), hist_percentile(h, 900), hist_percentile(h, 990),
+           dwt_cycles_to_ns(h->max));
+    if (h->bucket[HIST_BUCKETS] > 0) {
+        printk("  %-14s %u samples above %u ns\n\r", "",
+               h->bucket[HIST_BUCKETS], dwt_cycles_to_ns(HIST_BUCKETS * HIST_WIDTH));
+    }
+}
+
+static void lat_bench_thread_code(void *argA, void *argB, void *argC)
+{
+    const struct device *gpio0_dev = device_get_binding(DT_LABEL(GPIO0_NID));
+    uint32_t timeouts = 0;
+    int ret;
+
+    dwt_init();
+
+    ret = gpio_pin_configure(gpio0_dev, CONFIG_APP_LAT_BENCH_OUT_PIN, GPIO_OUTPUT_LOW);
+    if (ret < 0) {
+        printk("Error %d: lat bench failed to configure stimulus pin\n\r", ret);
+        return;
+    }
+
+    printk("lat bench: %d samples, P0.%02d -> BUT1\n\r",
+           CONFIG_APP_LAT_BENCH_SAMPLES, CONFIG_APP_LAT_BENCH_OUT_PIN);
+
+    for (int i = 0; i < CONFIG_APP_LAT_BENCH_SAMPLES; i++) {
+        uint32_t t0, isr, total;
+
+        gpio_pin_set_raw(gpio0_dev, CONFIG_APP_LAT_BENCH_OUT_PIN, 0);
+        k_busy_wait(LAT_BENCH_SETTLE_US);
+        k_sem_reset(&woken);
+
+        armed = true;
+        t0 = dwt_cycles();
+        gpio_pin_set_raw(gpio0_dev, CONFIG_APP_LAT_BENCH_OUT_PIN, 1);
+
+        if (k_sem_take(&woken, K_MSEC(100)) != 0) {
+            armed = false;
+            timeouts++;
+            continue;
+        }
+
+        total = t_thread - t0;
+        isr = t_isr - t0;
+        hist_add(&end_to_end, total);
+        hist_add(&edge_to_isr, isr);
+        hist_add(&isr_to_thread, total - isr);
+    }
+    gpio_pin_set_raw(gpio0_dev, CONFIG_APP_LAT_BENCH_OUT_PIN, 0);
+
+    printk("lat bench results (%u timeouts):\n\r", timeouts);
+    hist_print("edge->ISR", &edge_to_isr);
+    hist_print("ISR->thread", &isr_to_thread);
+    hist_print("end-to-end", &end_to_end);
+}
+
+K_THREAD_DEFINE(lat_bench_thread, LAT_BENCH_STACK_SIZE, lat_bench_thread_code,
+                NULL, NULL, NULL, LAT_BENCH_PRIO, 0, LAT_BENCH_START_MS);
@@ -0,0 +1,19 @@
+/*
+ * GPIO loopback interrupt-latency benchmark
+ *
+ * An output pin wired to the BUT1 input generates button edges. The DWT
+ * cycle counter is read at the stimulus, at button callback entry and when
+ * the manual handler wakes up, giving edge-to-ISR, ISR-to-thread and
+ * end-to-end latency distributions.
+ */
+
+#ifndef LAT_BENCH_H
+#define LAT_BENCH_H
+
+/* Button callback entry (ISR context) */
+void lat_bench_stamp_isr(void);
+
+/* Manual handler woken up by the button event */
+void lat_bench_stamp_thread(void);
+
+#endif /* LAT_BENCH_H */
@@ -0,0 +1,296 @@
+/*
+ * CPU load monitor
+ *
+ * Every APP_LOAD_MON_SAMPLE_MS a delayable work item records the cumulative
+ * runtime of each thread (CONFIG_THREAD_RUNTIME_STATS) into a ring of
+ * snapshots; the usage over any window inside the history is the
+ * difference between two snapshots. Sampling is the only periodic cost.
+ *
+ * The kernel charges interrupt time to the thread that was interrupted.
+ * With APP_LOAD_MON_ISR the ISR entry/exit tracing hooks time interrupts
+ * with the DWT cycle counter, so ISR time can be reported separately and
+ * removed from idle (where nearly all interrupts of this application hit).
+ * Thread shares otherwise include the interrupts that preempted them.
+ *
+ * Runtime statistics count in hardware cycles (k_cycle_get_32), 32-bit
+ * differences stay valid as long as the history is shorter than the
+ * counter wrap period.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <sys/byteorder.h>
+#include <string.h>
+#include <errno.h>
+
+#include "load_mon.h"
+
+#define MAX_THREADS CONFIG_APP_LOAD_MON_MAX_THREADS
+#define HISTORY     CONFIG_APP_LOAD_MON_HISTORY
+#define SAMPLE_MS   CONFIG_APP_LOAD_MON_SAMPLE_MS
+
+struct load_sample {
+    uint32_t time;                  /* k_cycle_get_32() at sampling */
+    uint32_t isr;                   /* Cumulative ISR time (hw cycles) */
+    uint32_t isr_idle;              /* ... of which interrupted idle */
+    uint32_t thread[MAX_THREADS];   /* Cumulative runtime per slot */
+};
+
+static struct load_sample history[HISTORY + 1];
+static unsigned int head;           /* Index of the newest sample */
+static unsigned int count;          /* Valid samples in history */
+
+static const struct k_thread *slot_thread[MAX_THREADS];
+static const struct k_thread *idle_thread;
+
+static void load_mon_sample(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sample_work, load_mon_sample);
+
+#if defined(CONFIG_APP_LOAD_MON_ISR)
+#include <tracing_user.h>
+#include "dwt.h"
+
+/* DWT cycle counter: interrupts are far shorter than a hw cycle (30.5 us) */
+static uint32_t isr_depth;
+static uint32_t isr_start;
+static bool isr_in_idle;
+static uint64_t isr_cpu_cycles;
+static uint64_t isr_idle_cpu_cycles;
+
+void sys_trace_isr_enter_user(int nested_interrupts)
+{
+    if (isr_depth++ == 0) {
+        isr_start = dwt_cycles();
+        isr_in_idle = (k_current_get() == idle_thread);
+    }
+}
+
+void sys_trace_isr_exit_user(int nested_interrupts)
+{
+    if (--isr_depth == 0) {
+        uint32_t d = dwt_cycles() - isr_start;
+
+        isr_cpu_cycles += d;
+        if (isr_in_idle) {
+            isr_idle_cpu_cycles += d;
+        }
+    }
+}
+
+static void isr_read(uint32_t *isr, uint32_t *isr_idle)
+{
+    unsigned int key = irq_lock();
+    uint64_t total = isr_cpu_cycles;
+    uint64_t idle = isr_idle_cpu_cycles;
+
+    irq_unlock(key);
+
+    /* CPU cycles to hardware (runtime statistics) cycles */
+    *isr = (uint32_t)(total * sys_clock_hw_cycles_per_sec() / SystemCoreClock);
+    *isr_idle = (uint32_t)(idle * sys_clock_hw_cycles_per_sec() / SystemCoreClock);
+}
+#else
+static void isr_read(uint32_t *isr, uint32_t *isr_idle)
+{
+    *isr = 0;
+    *isr_idle = 0;
+}
+#endif /* CONFIG_APP_LOAD_MON_ISR */
+
+/* Slot of "thread", allocating one if needed. -1 if the table is full */
+static int slot_get(const struct k_thread *thread)
+{
+    int free_slot = -1;
+
+    for (int i = 0; i < MAX_THREADS; i++) {
+        if (slot_thread[i] == thread) {
+            return i;
+        }
+        if (slot_thread[i] == NULL && free_slot < 0) {
+            free_slot = i;
+        }
+    }
+    if (free_slot >= 0) {
+        slot_thread[free_slot] = thread;
+    }
+
+    return free_slot;
+}
+
+static void sample_thread(const struct k_thread *thread, void *user_data)
+{
+    struct load_sample *s = user_data;
+    k_thread_runtime_stats_t stats;
+    int slot = slot_get(thread);
+
+    if (slot < 0) {
+        return;
+    }
+    /* The idle thread's name differs between kernel versions */
+    if (idle_thread == NULL && k_thread_priority_get((k_tid_t)thread) == K_IDLE_PRIO) {
+        idle_thread = thread;
+    }
+    if (k_thread_runtime_stats_get((k_tid_t)thread, &stats) == 0) {
+        s->thread[slot] = (uint32_t)stats.execution_cycles;
+    }
+}
+
+static void load_mon_sample(struct k_work *work)
+{
+    unsigned int next = (head + 1) % (HISTORY + 1);
+    struct load_sample *s = &history[next];
+
+    /* Threads that have exited keep their last runtime: their share drops
+     * to zero instead of wrapping around in the window difference */
+    memset(s, 0, sizeof(*s));
+    if (count > 0) {
+        memcpy(s->thread, history[head].thread, sizeof(s->thread));
+    }
+    k_thread_foreach(sample_thread, s);
+    isr_read(&s->isr, &s->isr_idle);
+    s->time = k_cycle_get_32();
+
+    head = next;
+    if (count < HISTORY + 1) {
+        count++;
+    }
+
+#if CONFIG_APP_LOAD_MON_DUMP_PERIOD_S > 0
+    static unsigned int since_dump;
+
+    if (++since_dump * SAMPLE_MS >= CONFIG_APP_LOAD_MON_DUMP_PERIOD_S * MSEC_PER_SEC) {
+        since_dump = 0;
+        load_mon_dump();
+    }
+#endif
+
+    k_work_schedule(&sample_work, K_MSEC(SAMPLE_MS));
+}
+
+/* Usage over a window, in permille */
+struct load_window {
+    uint16_t busy_pm;
+    uint16_t isr_pm;
+    uint16_t idle_pm;
+    uint16_t thread_pm[MAX_THREADS];
+};
+
+/* Usage over the last "n" sample periods. Returns the number of periods
+ * actually covered (0 if there is no history yet) */
+static unsigned int window_get(unsigned int n, struct load_window *w)
+{
+    const struct load_sample *now, *then;
+    uint32_t elapsed, isr_idle;
+
+    n = MIN(n, count - 1);
+    if (count < 2 || n == 0) {
+        return 0;
+    }
+    now = &history[head];
+    then = &history[(head + HISTORY + 1 - n) % (HISTORY + 1)];
+    elapsed = now->time - then->time;
+    if (elapsed == 0) {
+        return 0;
+    }
+
+    isr_idle = now->isr_idle - then->isr_idle;
+    w->isr_pm = (uint16_t)((uint64_t)(now->isr - then->isr) * 1000 / elapsed);
+    w->idle_pm = 0;
+    for (int i = 0; i < MAX_THREADS; i++) {
+        uint32_t d = now->thread[i] - then->thread[i];
+
+        if (slot_thread[i] == idle_thread && idle_thread != NULL) {
+            d = (d > isr_idle) ? d - isr_idle : 0;
+            w->idle_pm = (uint16_t)((uint64_t)d * 1000 / elapsed);
+        }
+        w->thread_pm[i] = (uint16_t)((uint64_t)d * 1000 / elapsed);
+    }
+    w->busy_pm = 1000 - MIN(w->idle_pm, 1000);
+
+    return n;
+}
+
+int load_mon_snapshot(uint16_t window_s, uint8_t *buf, size_t len)
+{
+    struct load_mon_snapshot_hdr hdr;
+    struct load_window w = { 0 };
+    size_t pos = sizeof(hdr);
+    unsigned int n = (window_s * MSEC_PER_SEC + SAMPLE_MS - 1) / SAMPLE_MS;
+
+    if (len < sizeof(hdr)) {
+        return -ENOMEM;
+    }
+    n = window_get(n, &w);
+
+    hdr.version = LOAD_MON_SNAPSHOT_VERSION;
+    hdr.n_threads = 0;
+    hdr.window_s = sys_cpu_to_le16((uint16_t)(n * SAMPLE_MS / MSEC_PER_SEC));
+    hdr.busy_pm = sys_cpu_to_le16(w.busy_pm);
+    hdr.isr_pm = sys_cpu_to_le16(w.isr_pm);
+    hdr.idle_pm = sys_cpu_to_le16(w.idle_pm);
+
+    for (int i = 0; i < MAX_THREADS; i++) {
+        struct load_mon_snapshot_entry e;
+        const char *name;
+
+        if (slot_thread[i] == NULL) {
+            continue;
+        }
+        if (pos + sizeof(e) > len) {
+            return -ENOMEM;
+        }
+        name = k_thread_name_get((k_tid_t)slot_thread[i]);
+        memset(e.name, 0, sizeof(e.name));
+        strncpy(e.name, name ? name : "", sizeof(e.name));
+        e.share_pm = sys_cpu_to_le16(w.thread_pm[i]);
+        memcpy(&buf[pos], &e, sizeof(e));
+        pos += sizeof(e);
+        hdr.n_threads++;
+    }
+    memcpy(buf, &hdr, sizeof(hdr));
+
+    return (int)pos;
+}
+
+static void dump_window(const char *label, unsigned int n)
+{
+    struct load_window w = { 0 };
+
+    n = window_get(n, &w);
+    if (n == 0) {
+        printk("load %s: no data\n\r", label);
+        return;
+    }
+
+    printk("load %s: busy %u.%u%% isr %u.%u%% idle %u.%u%%\n\r", label,
+           w.busy_pm / 10, w.busy_pm % 10, w.isr_pm / 10, w.isr_pm % 10,
+           w.idle_pm / 10, w.idle_pm % 10);
+    for (int i = 0; i < MAX_THREADS; i++) {
+        const char *name;
+
+        if (slot_thread[i] == NULL || slot_thread[i] == idle_thread) {
+            continue;
+        }
+        name = k_thread_name_get((k_tid_t)slot_thread[i]);
+        printk("    %-12s %u.%u%%\n\r", name ? name : "?",
+               w.thread_pm[i] / 10, w.thread_pm[i] % 10);
+    }
+}
+
+void load_mon_dump(void)
+{
+    dump_window("1s", MSEC_PER_SEC / SAMPLE_MS);
+    dump_window("10s", 10 * MSEC_PER_SEC / SAMPLE_MS);
+    dump_window("all", HISTORY);
+}
+
+int load_mon_init(void)
+{
+#if defined(CONFIG_APP_LOAD_MON_ISR)
+    dwt_init();
+#endif
+
+    k_work_schedule(&sample_work, K_NO_WAIT);
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * CPU load monitor
+ *
+ * Samples the kernel per-thread runtime statistics at a fixed period and
+ * keeps a short history, so utilization can be reported over sliding
+ * windows, broken down by thread, ISR and idle.
+ */
+
+#ifndef LOAD_MON_H
+#define LOAD_MON_H
+
+#include <zephyr/types.h>
+#include <stddef.h>
+
+/* Binary snapshot format version */
+#define LOAD_MON_SNAPSHOT_VERSION 1
+
+/* Length of the thread name stored in a binary snapshot entry */
+#define LOAD_MON_NAME_LEN 8
+
+/* Binary snapshot header, followed by "n_threads" entries.
+ * All shares are in permille of the window, little-endian. */
+struct load_mon_snapshot_hdr {
+    uint8_t version;
+    uint8_t n_threads;
+    uint16_t window_s;
+    uint16_t busy_pm;       /* 1000 - idle */
+    uint16_t isr_pm;
+    uint16_t idle_pm;
+} __packed;
+
+struct load_mon_snapshot_entry {
+    char name[LOAD_MON_NAME_LEN];   /* Not NUL terminated if 8 chars long */
+    uint16_t share_pm;
+} __packed;
+
+/* Start sampling. Returns 0 */
+int load_mon_init(void);
+
+/* Write a binary snapshot over the last "window_s" seconds (clamped to the
+ * history length) into "buf". Returns the number of bytes written or
+ * -ENOMEM if "len" is too small. */
+int load_mon_snapshot(uint16_t window_s, uint8_t *buf, size_t len);
+
+/* Print utilization over 1 s, 10 s and the full history */
+void load_mon_dump(void);
+
+#endif /* LOAD_MON_H */
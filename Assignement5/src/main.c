@@ -31,7 +31,19 @@
 #include <timing/timing.h>
 #include <stdio.h>
 
-static struct gpio_callback but1_cb_data; /* Callback structure */
+#include "pwm_out.h"
+#include "clock.h"
+#include "alarm.h"
+#include "exec_bench.h"
+#include "load_mon.h"
+#include "manual.h"
+#include "edge_count.h"
+#include "prof.h"
+#include "evt_log.h"
+#include "power.h"
+#include "telem.h"
+#include "curve.h"
+
 /* Size of stack area used by each thread (can be thread specific, if necessary)*/
 #define STACK_SIZE 1024
 
@@ -39,207 +51,259 @@ static struct gpio_callback but1_cb_data; /* Callback structure */
 #define thread_manual_prio 1
 #define thread_relogio_prio 1
 
-/* Therad periodicity (in ms)*/
-#define thread_relogio_period 1000
+/* The relogio period (one second) follows the clock schedule, see
+ * clock_next_due() */
 
+#if defined(CONFIG_APP_EXEC_THREADS)
 
 /* Create thread stack space */
 K_THREAD_STACK_DEFINE(thread_manual_stack, STACK_SIZE);
+#if !defined(CONFIG_APP_CLOCK_TIMER)
 K_THREAD_STACK_DEFINE(thread_relogio_stack, STACK_SIZE);
+#endif
   
 /* Create variables for thread data */
 struct k_thread thread_manual_data;
+#if !defined(CONFIG_APP_CLOCK_TIMER)
 struct k_thread thread_relogio_data;
+#endif
 
 /* Create task IDs */
 k_tid_t thread_manual_tid;
+#if !defined(CONFIG_APP_CLOCK_TIMER)
 k_tid_t thread_relogio_tid;
-
-/** Global vars (shared memory between tasks A/B and B/C, resp) */
-int seg = 0;
-int min = 0;
-int horas = 0;
-
-/** Semaphores for task synch */
-struct k_sem sem_manual;
+#endif
 
 /* Thread code prototypes */
 void thread_manual_code(void *argA, void *argB, void *argC);
+#if !defined(CONFIG_APP_CLOCK_TIMER)
 void thread_relogio_code(void *argA, void *argB, void *argC);
+#endif
+
+#else /* CONFIG_APP_EXEC_WORKQ */
+
+/* Event-driven mode: clock tick, button handling and output all run as work
+ * items on one work queue, so a single stack replaces the two thread stacks */
+K_THREAD_STACK_DEFINE(app_workq_stack, STACK_SIZE);
+struct k_work_q app_workq;
+
+static void manual_work_handler(struct k_work *work);
+static void manual_notify(void);
+
+static K_WORK_DEFINE(manual_work, manual_work_handler);
+
+#if !defined(CONFIG_APP_CLOCK_TIMER)
+static void relogio_work_handler(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(relogio_work, relogio_work_handler);
+
+static int64_t relogio_due;     /* Next release of the clock tick (kernel ticks) */
+#endif
+
+#endif /* CONFIG_APP_EXEC_THREADS */
 
-/* Refer to dts file */
-#define GPIO0_NID DT_NODELABEL(gpio0) 
-#define BOARDLED_PIN 0xe /* Pin at which LED is connected. Addressing is direct (i.e., pin number) */
-#define BOARDBUT1 0xb /* Pin at which BUT1 is connected. Addressing is direct (i.e., pin number) */
-#define PWM0_NID DT_NODELABEL(pwm0)
+#if defined(CONFIG_APP_CLOCK_TIMER)
+
+/* Timer tick mode: the clock advances in the timer expiry function (ISR),
+ * replacing the relogio thread or work item. The timer is re-armed at the
+ * absolute due time of the next tick, so it does not drift with
+ * scheduling delays */
+static void relogio_timer_expiry(struct k_timer *timer);
+static K_TIMER_DEFINE(relogio_timer, relogio_timer_expiry, NULL);
+
+static int64_t relogio_due;             /* Next release (kernel ticks) */
+static int64_t relogio_release_time;    /* Release instant of the last tick (ms) */
+
+#if defined(CONFIG_APP_EXEC_BENCH)
+/* The bench report prints, which does not belong in ISR context */
+static void relogio_bench_handler(struct k_work *work)
+{
+    exec_bench_tick(relogio_release_time);
+}
+
+static K_WORK_DEFINE(relogio_bench_work, relogio_bench_handler);
+#endif
+
+#endif /* CONFIG_APP_CLOCK_TIMER */
 
 /* Main function */
 void main(void) {
 
-    /** Create and init semaphores */
-    k_sem_init(&sem_manual, 0, 1);
+    if (IS_ENABLED(CONFIG_APP_EVT_LOG)) {
+        evt_log_init();
+    }
+    if (IS_ENABLED(CONFIG_APP_POWER)) {
+        power_init();
+    }
 
-     
+#if defined(CONFIG_APP_ALARM_BENCH)
+    alarm_bench_run();
+#endif
+#if defined(CONFIG_APP_CIVIL_BENCH)
+    civil_bench_run();
+#endif
+#if defined(CONFIG_APP_CURVE_BENCH)
+    curve_bench_run();
+#endif
+#if defined(CONFIG_APP_EDGE_COUNT_BENCH)
+    edge_count_bench_run();
+#endif
+
+    if (IS_ENABLED(CONFIG_APP_LOAD_MON)) {
+        load_mon_init();
+    }
+    if (IS_ENABLED(CONFIG_APP_PROF)) {
+        prof_init();
+    }
 
+#if defined(CONFIG_APP_EXEC_THREADS)
     thread_manual_tid = k_thread_create(&thread_manual_data, thread_manual_stack,
         K_THREAD_STACK_SIZEOF(thread_manual_stack), thread_manual_code,
         NULL, NULL, NULL, thread_manual_prio, 0, K_NO_WAIT);
+    k_thread_name_set(thread_manual_tid, "manual");
+#if !defined(CONFIG_APP_CLOCK_TIMER)
     thread_relogio_tid = k_thread_create(&thread_relogio_data, thread_relogio_stack,
         K_THREAD_STACK_SIZEOF(thread_relogio_stack), thread_relogio_code,
         NULL, NULL, NULL, thread_relogio_prio, 0, K_NO_WAIT);
+    k_thread_name_set(thread_relogio_tid, "relogio");
+#endif
+#else
+    k_work_queue_start(&app_workq, app_workq_stack,
+        K_THREAD_STACK_SIZEOF(app_workq_stack), thread_manual_prio, NULL);
+    k_thread_name_set(&app_workq.thread, "app_workq");
+
+    if (manual_init(manual_notify) == 0) {
+        printk("Event-driven mode: single work queue\n\r");
+#if !defined(CONFIG_APP_CLOCK_TIMER)
+        relogio_due = clock_next_due();
+        k_work_schedule_for_queue(&app_workq, &relogio_work,
+            K_TIMEOUT_ABS_TICKS(relogio_due));
+#endif
+    }
+#endif
 
+#if defined(CONFIG_APP_CLOCK_TIMER)
+    printk("Clock tick in timer ISR\n\r");
+    relogio_due = clock_next_due();
+    k_timer_start(&relogio_timer, K_TIMEOUT_ABS_TICKS(relogio_due), K_NO_WAIT);
+#endif
 
     return;
 
 } 
 
-/* Thread code implementation */
-void thread_manual_code(void *argA , void *argB, void *argC)
-{
-    /* Local vars */
-    
-    int ret=0;                              /* Generic return value variable */
-    
-    /* Task init code */
-    printk("Thread A init (periodic)\n");
-   
-    /* Callback function and variables*/
-    volatile int dcToggleFlag = 0; /* Flag to signal a BUT1 press */
+#if !defined(CONFIG_APP_CLOCK_TIMER)
 
-    void but1press_cbfunction(const struct device *dev, struct gpio_callback *cb, uint32_t pins){
-    
-    /* Inform that button was hit*/
-    printk("But1 pressed at %d\n\r", k_cycle_get_32());
-    
-    /* Update Flag*/
-    dcToggleFlag = 1;
-}
+/* One clock period: "release_time" is the instant the tick was due */
+static void relogio_process(int64_t release_time)
+{
+    printk("Thread Relogio activated\n\r");  
 
-  /* Local vars */
-    const struct device *gpio0_dev;         /* Pointer to GPIO device structure */
-    const struct device *pwm0_dev;          /* Pointer to PWM device structure */
-      
-    unsigned int pwmPeriod_us = 1000;       /* PWM priod in us */
-    unsigned int dcValue[]={0,33,66,100};   /* Duty-cycle in % */
-    unsigned int dcIndex=0;                 /* DC Index */
-    
-    /* Task init code */
-    printk("pwmDemo\n\r"); 
-    printk("Hit But1 to cycle among intensities ...\n\r ");
-
-    /* Bind to GPIO 0 and PWM0 */
-    gpio0_dev = device_get_binding(DT_LABEL(GPIO0_NID));
-    if (gpio0_dev == NULL) {
-        printk("Error: Failed to bind to GPIO0\n\r");        
-	return;
-    }
-    else {
-        printk("Bind to GPIO0 successfull \n\r");        
-    }
-    
-    pwm0_dev = device_get_binding(DT_LABEL(PWM0_NID));
-    if (pwm0_dev == NULL) {
-	printk("Error: Failed to bind to PWM0\n r");
-	return;
-    }
-    else  {
-        printk("Bind to PWM0 successful\n\r");            
+    clock_tick();
+    if (IS_ENABLED(CONFIG_APP_TELEM)) {
+        telem_clock(clock_get_epoch());
     }
 
-    
-    /* Configure PINS */    
-    
-    /* Note that PCB does not include pull-up resistors */
-    /* See nRF52840v1.0.0 DK Users Guide V 1.0.0, pg 29 */
-    ret = gpio_pin_configure(gpio0_dev, BOARDBUT1, GPIO_INPUT | GPIO_PULL_UP);
-    if (ret < 0) {
-        printk("Error %d: Failed to configure BUT 1 \n\r", ret);
-	return;
+    if (IS_ENABLED(CONFIG_APP_EXEC_BENCH)) {
+        exec_bench_tick(release_time);
     }
+}
 
-    /* Set interrupt HW - which pin and event generate interrupt */
-    ret = gpio_pin_interrupt_configure(gpio0_dev, BOARDBUT1, GPIO_INT_EDGE_TO_ACTIVE);
-    if (ret != 0) {
-	printk("Error %d: failed to configure interrupt on BUT1 pin \n\r", ret);
-	return;
-    }
-    
-    /* Set callback */
-    gpio_init_callback(&but1_cb_data, but1press_cbfunction, BIT(BOARDBUT1));
-    gpio_add_callback(gpio0_dev, &but1_cb_data);
-    
-    
-    /* main loop */
-    while(1) {    
-    
-    k_sem_take(&sem_manual,  K_FOREVER);    
-               
-        if(dcToggleFlag) {
-            dcIndex++;
-            if(dcIndex == 4) 
-                dcIndex = 0;
-            dcToggleFlag = 0;
-            printk("PWM DC value set to %u %%\n\r",dcValue[dcIndex]);
-
-            ret = pwm_pin_set_usec(pwm0_dev, BOARDLED_PIN,
-		      pwmPeriod_us,(unsigned int)((pwmPeriod_us*dcValue[dcIndex])/100), PWM_POLARITY_NORMAL);
-            if (ret) {
-                printk("Error %d: failed to set pulse width\n", ret);
-		return;
-            }
-        }            
-           
+#else /* CONFIG_APP_CLOCK_TIMER */
+
+static void relogio_timer_expiry(struct k_timer *timer)
+{
+    relogio_release_time = k_ticks_to_ms_floor64(relogio_due);
+
+    clock_tick();
+    if (IS_ENABLED(CONFIG_APP_TELEM)) {
+        telem_clock(clock_get_epoch());
     }
+    relogio_due = clock_next_due();
+    k_timer_start(&relogio_timer, K_TIMEOUT_ABS_TICKS(relogio_due), K_NO_WAIT);
 
-    return;
-    k_sem_give(&sem_manual);
+#if defined(CONFIG_APP_EXEC_BENCH)
+    k_work_submit(&relogio_bench_work);
+#endif
 }
-        
+
+#endif /* CONFIG_APP_CLOCK_TIMER */
+
+#if defined(CONFIG_APP_EXEC_THREADS)
+
+/* Thread code implementation */
+void thread_manual_code(void *argA , void *argB, void *argC)
+{
+    /* Task init code */
+    printk("Thread A init (periodic)\n");
+
+    if (manual_init(NULL) != 0) {
+        return;
+    }
     
+    /* main loop: buttons, commands and signals are all served from here */
+    while(1) {    
+        int ret;
 
-   
+        manual_wait();
 
+        /* A failed command or update must not stop the button handling */
+        ret = manual_process();
+        if (ret != 0) {
+            printk("Error %d: manual control\n\r", ret);
+        }
+    }
+}
 
+#if !defined(CONFIG_APP_CLOCK_TIMER)
 /* Thread code implementation */
 void thread_relogio_code(void *argA , void *argB, void *argC)
 {
     /* Local vars */
-    int64_t fin_time=0, release_time=0;     /* Timing variables to control task periodicity */
-    
-    int ret=0;                              /* Generic return value variable */
+    int64_t due;        /* Next release instant (kernel ticks), from the clock schedule */
     
     /* Task init code */
     printk("Thread Relogio init (periodic)\n");
            
     /* Compute next release instant */
-    release_time = k_uptime_get() + thread_relogio_period;
+    due = clock_next_due();
 
     /* Thread loop */
     while(1) {        
         
-        printk("Thread Relogio activated\n\r");  
-        
-        seg=seg+1;
-
-        if(seg < 60)
-          seg=seg+1;
-        else
-          seg=0;
-          min=min+1;
-
-        if(min > 59)
-          min=0;
-          horas=horas + 1;
-        
-        if(horas >24)
-          horas=0;    
-              
         /* Wait for next release instant */ 
-        fin_time = k_uptime_get();
-        if( fin_time < release_time) {
-            k_msleep(release_time - fin_time);
-            release_time += thread_A_period;
+        k_sleep(K_TIMEOUT_ABS_TICKS(due));
 
-        }
+        relogio_process(k_ticks_to_ms_floor64(due));
+        due = clock_next_due();
     }
 }
+#endif
+
+#else /* CONFIG_APP_EXEC_WORKQ */
+
+static void manual_work_handler(struct k_work *work)
+{
+    manual_process();
+}
+
+/* Any manual input became ready: (re)submitting a pending item is a no-op,
+ * and manual_process() drains everything queued up to then */
+static void manual_notify(void)
+{
+    k_work_submit_to_queue(&app_workq, &manual_work);
+}
+
+#if !defined(CONFIG_APP_CLOCK_TIMER)
+static void relogio_work_handler(struct k_work *work)
+{
+    relogio_process(k_ticks_to_ms_floor64(relogio_due));
+
+    /* Absolute timeout: the period does not drift with handler run time */
+    relogio_due = clock_next_due();
+    k_work_schedule_for_queue(&app_workq, &relogio_work,
+        K_TIMEOUT_ABS_TICKS(relogio_due));
+}
+#endif
+
+#endif /* CONFIG_APP_EXEC_THREADS */
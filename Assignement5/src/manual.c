@@ -0,0 +1,435 @@
+/*
+ * Manual control: buttons, commands and signals driving the LED PWM
+ *
+ * Commands are copied into a memory slab so producers (including ISRs)
+ * do not have to keep them alive; the consumer frees them once handled.
+ * Signal bits accumulate in an atomic word and the poll signal only
+ * serves as the wake-up.
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/gpio.h>
+#include <sys/printk.h>
+#include <sys/atomic.h>
+#include <errno.h>
+
+#include "manual.h"
+#include "pwm_out.h"
+#include "exec_bench.h"
+#include "lat_bench.h"
+#include "debounce.h"
+#include "hot.h"
+#include "evt_log.h"
+#include "gesture.h"
+#include "clock_ui.h"
+#include "metrics.h"
+#include "telem.h"
+#include "pwm_cmd.h"
+
+/* Refer to dts file */
+#define GPIO0_NID DT_NODELABEL(gpio0) 
+#define BOARDLED_PIN 0xe /* Pin at which LED is connected. Addressing is direct (i.e., pin number) */
+#define BOARDBUT1 0xb /* Pin at which BUT1 is connected. Addressing is direct (i.e., pin number) */
+#define BOARDBUT2 0xc
+#define BOARDBUT3 0x18
+#define BOARDBUT4 0x19
+
+/* Command queued in manual_fifo; first word reserved for the kernel */
+struct manual_cmd_item {
+    void *fifo_reserved;
+    struct manual_cmd cmd;
+};
+
+K_MEM_SLAB_DEFINE(manual_cmd_slab, sizeof(struct manual_cmd_item),
+                  CONFIG_APP_MANUAL_CMD_POOL, 4);
+
+/* Input sources */
+static K_SEM_DEFINE(sem_manual, 0, 1);     /* BUT1 pressed */
+static K_FIFO_DEFINE(manual_fifo);          /* Commands */
+static struct k_poll_signal manual_sig = K_POLL_SIGNAL_INITIALIZER(manual_sig);
+static atomic_t manual_sig_bits;
+
+static struct k_poll_event manual_events[] = {
+    K_POLL_EVENT_STATIC_INITIALIZER(K_POLL_TYPE_SEM_AVAILABLE,
+                                    K_POLL_MODE_NOTIFY_ONLY, &sem_manual, 0),
+    K_POLL_EVENT_STATIC_INITIALIZER(K_POLL_TYPE_FIFO_DATA_AVAILABLE,
+                                    K_POLL_MODE_NOTIFY_ONLY, &manual_fifo, 0),
+    K_POLL_EVENT_STATIC_INITIALIZER(K_POLL_TYPE_SIGNAL,
+                                    K_POLL_MODE_NOTIFY_ONLY, &manual_sig, 0),
+};
+
+static void (*manual_notify)(void);
+
+METRIC_COUNTER_DEFINE(button_presses);
+METRIC_COUNTER_DEFINE(duty_changes);
+METRIC_COUNTER_DEFINE(manual_cmd_dropped);
+METRIC_GAUGE_DEFINE(led_duty_permille);
+
+/* Manual (button -> PWM) control state */
+static const struct device *gpio0_dev;          /* Pointer to GPIO device structure */
+static unsigned int dcValue[]={0,33,66,100};    /* Duty-cycle in % */
+static unsigned int dcIndex=0;                  /* DC Index */
+
+#if defined(CONFIG_APP_GESTURE)
+/* BUT1: duty-cycle; BUT2..4: clock-set UI (mode, up, down) */
+static const struct {
+    uint32_t pin;
+    uint32_t options;
+} gesture_buttons[] = {
+    { BOARDBUT1, 0 },
+    { BOARDBUT2, GESTURE_OPT_DOUBLE },
+    { BOARDBUT3, 0 },
+    { BOARDBUT4, 0 },
+};
+
+#if defined(CONFIG_APP_EDGE_COUNT)
+BUILD_ASSERT(CONFIG_APP_EDGE_COUNT_PIN != BOARDBUT1 && CONFIG_APP_EDGE_COUNT_PIN != BOARDBUT2 &&
+             CONFIG_APP_EDGE_COUNT_PIN != BOARDBUT3 && CONFIG_APP_EDGE_COUNT_PIN != BOARDBUT4,
+             "APP_EDGE_COUNT_PIN is a gesture button: move it off BUT1..BUT4");
+#endif
+#elif defined(CONFIG_APP_DEBOUNCE)
+static struct debounce_input but1_input;  /* Debounced BUT1 */
+#else
+static struct gpio_callback but1_cb_data; /* Callback structure */
+#endif
+
+static inline void notify(void)
+{
+    if (manual_notify != NULL) {
+        manual_notify();
+    }
+}
+
+#if !defined(CONFIG_APP_GESTURE)
+static APP_HOT void but1_event(void){
+    
+    if (IS_ENABLED(CONFIG_APP_LAT_BENCH)) {
+        lat_bench_stamp_isr();
+    }
+    if (IS_ENABLED(CONFIG_APP_EXEC_BENCH)) {
+        exec_bench_input_stamp();
+    }
+
+    metric_inc(METRIC(button_presses));
+
+    /* Inform that button was hit*/
+    printk("But1 pressed at %d\n\r", k_cycle_get_32());
+    
+    if (IS_ENABLED(CONFIG_APP_EVT_LOG)) {
+        evt_log(EVT_BUTTON, 1);
+    }
+    if (IS_ENABLED(CONFIG_APP_TELEM)) {
+        telem_button(1, TELEM_PRESS);
+    }
+
+    /* Wake up the manual handler */
+    k_sem_give(&sem_manual);
+    notify();
+}
+#endif
+
+#if defined(CONFIG_APP_GESTURE)
+/* Recognized gesture, in ISR context: handled by the consumer like a command */
+static void button_gesture(int button, enum gesture gesture)
+{
+    struct manual_cmd cmd = {
+        .type = MANUAL_CMD_GESTURE,
+        .button = (uint8_t)button,
+        .gesture = (uint8_t)gesture,
+    };
+    int ret;
+
+    metric_inc(METRIC(button_presses));
+    if (IS_ENABLED(CONFIG_APP_EVT_LOG)) {
+        evt_log(EVT_BUTTON, (uint16_t)((button + 1) | (gesture << 8)));
+    }
+    if (IS_ENABLED(CONFIG_APP_TELEM)) {
+        telem_button((uint8_t)(button + 1), (uint8_t)gesture);
+    }
+
+    /* Command slab exhausted: the gesture is counted above, record its loss */
+    ret = manual_post(&cmd);
+    if (ret != 0) {
+        metric_inc(METRIC(manual_cmd_dropped));
+        if (IS_ENABLED(CONFIG_APP_EVT_LOG)) {
+            evt_log(EVT_CMD_ERR, (uint16_t)-ret);
+        }
+    }
+}
+#elif defined(CONFIG_APP_DEBOUNCE)
+/* Debounced BUT1 state change */
+static APP_HOT void but1_debounced(struct debounce_input *in, bool active)
+{
+    if (active) {
+        but1_event();
+    }
+}
+#else
+APP_HOT void but1press_cbfunction(const struct device *dev, struct gpio_callback *cb, uint32_t pins){
+    but1_event();
+}
+#endif
+
+int manual_post(const struct manual_cmd *cmd)
+{
+    struct manual_cmd_item *item;
+
+    if (k_mem_slab_alloc(&manual_cmd_slab, (void **)&item, K_NO_WAIT) != 0) {
+        return -ENOMEM;
+    }
+    item->cmd = *cmd;
+    k_fifo_put(&manual_fifo, item);
+    notify();
+
+    return 0;
+}
+
+void manual_signal(uint32_t bits)
+{
+    atomic_or(&manual_sig_bits, bits);
+    k_poll_signal_raise(&manual_sig, 0);
+    notify();
+}
+
+void manual_wait(void)
+{
+    k_poll(manual_events, ARRAY_SIZE(manual_events), K_FOREVER);
+
+    for (size_t i = 0; i < ARRAY_SIZE(manual_events); i++) {
+        manual_events[i].state = K_POLL_STATE_NOT_READY;
+    }
+}
+
+/* Through the coalescing queue when there is one; the update then takes
+ * effect asynchronously */
+static int led_set_duty(uint32_t pin, uint16_t permille)
+{
+    if (IS_ENABLED(CONFIG_APP_PWM_CMD)) {
+        return pwm_cmd_post(pin, permille);
+    }
+
+    return pwm_out_set_duty(pin, permille);
+}
+
+static int set_duty_index(unsigned int idx)
+{
+    int ret;
+
+    dcIndex = idx;
+    printk("PWM DC value set to %u %%\n\r",dcValue[dcIndex]);
+
+    /* PWM frequency is CONFIG_APP_PWM_FREQ_HZ, changeable at runtime */
+    ret = led_set_duty(BOARDLED_PIN, (uint16_t)(dcValue[dcIndex] * 10));
+    metric_inc(METRIC(duty_changes));
+    metric_set(METRIC(led_duty_permille), dcValue[dcIndex] * 10);
+    if (IS_ENABLED(CONFIG_APP_EVT_LOG)) {
+        evt_log(EVT_DUTY, (uint16_t)(dcValue[dcIndex] * 10));
+    }
+    if (IS_ENABLED(CONFIG_APP_TELEM)) {
+        telem_duty(BOARDLED_PIN, (uint16_t)(dcValue[dcIndex] * 10));
+    }
+    if (ret) {
+        printk("Error %d: failed to set pulse width\n", ret);
+    }
+
+    return ret;
+}
+
+static int step_duty(void)
+{
+    return set_duty_index((dcIndex + 1) % ARRAY_SIZE(dcValue));
+}
+
+#if defined(CONFIG_APP_GESTURE)
+static int handle_gesture(uint8_t button, enum gesture gesture)
+{
+    if (button == 0) {
+        /* BUT1: short press steps the intensity, long press switches off */
+        if (gesture == GESTURE_SHORT) {
+            printk("But1 short press\n\r");
+            return step_duty();
+        }
+        if (gesture == GESTURE_LONG) {
+            return set_duty_index(0);
+        }
+        return 0;
+    }
+
+    return clock_ui_gesture((enum clock_ui_key)(button - 1), gesture);
+}
+#endif
+
+static int handle_cmd(const struct manual_cmd *cmd)
+{
+    uint32_t pin;
+    int ret = 0;
+
+    switch (cmd->type) {
+    case MANUAL_CMD_STEP:
+        ret = step_duty();
+        break;
+    case MANUAL_CMD_SET_DUTY:
+        pin = (cmd->pin == MANUAL_PIN_LED) ? BOARDLED_PIN : cmd->pin;
+        ret = led_set_duty(pin, cmd->permille);
+        metric_inc(METRIC(duty_changes));
+        if (pin == BOARDLED_PIN) {
+            metric_set(METRIC(led_duty_permille), cmd->permille);
+        }
+        if (IS_ENABLED(CONFIG_APP_EVT_LOG)) {
+            evt_log(EVT_DUTY, cmd->permille);
+        }
+        if (IS_ENABLED(CONFIG_APP_TELEM)) {
+            telem_duty((uint8_t)pin, cmd->permille);
+        }
+        if (ret == 0) {
+            printk("PWM DC value of pin %u set to %u.%u %%\n\r", pin,
+                   cmd->permille / 10, cmd->permille % 10);
+        }
+        break;
+#if defined(CONFIG_APP_GESTURE)
+    case MANUAL_CMD_GESTURE:
+        ret = handle_gesture(cmd->button, (enum gesture)cmd->gesture);
+        break;
+#endif
+    default:
+        ret = -EINVAL;
+        break;
+    }
+
+    return ret;
+}
+
+int manual_process(void)
+{
+    struct manual_cmd_item *item;
+    unsigned int signaled;
+    int result;
+    int err;
+    int ret = 0;
+
+    /* Button: one step per wake-up, as the semaphore saturates at 1 */
+    if (k_sem_take(&sem_manual, K_NO_WAIT) == 0) {
+        if (IS_ENABLED(CONFIG_APP_LAT_BENCH)) {
+            lat_bench_stamp_thread();
+        }
+        if (IS_ENABLED(CONFIG_APP_EXEC_BENCH)) {
+            exec_bench_input_handled();
+        }
+        err = step_duty();
+        ret = err ? err : ret;
+    }
+
+    /* Commands: drain the whole batch */
+    while ((item = k_fifo_get(&manual_fifo, K_NO_WAIT)) != NULL) {
+        err = handle_cmd(&item->cmd);
+        ret = err ? err : ret;
+        k_mem_slab_free(&manual_cmd_slab, (void **)&item);
+    }
+
+    /* Signals */
+    k_poll_signal_check(&manual_sig, &signaled, &result);
+    if (signaled) {
+        uint32_t bits;
+
+        k_poll_signal_reset(&manual_sig);
+        bits = (uint32_t)atomic_clear(&manual_sig_bits);
+        if (bits & MANUAL_SIG_STEP) {
+            err = step_duty();
+            ret = err ? err : ret;
+        }
+    }
+
+    return ret;
+}
+
+/* Bind devices and configure BUT1 and its interrupt. Returns 0 or the error */
+int manual_init(void (*notify_fn)(void))
+{
+    int ret=0;                              /* Generic return value variable */
+
+    manual_notify = notify_fn;
+
+    /* Task init code */
+    printk("pwmDemo\n\r"); 
+    printk("Hit But1 to cycle among intensities ...\n\r ");
+
+    /* Bind to GPIO 0 and PWM0 */
+    gpio0_dev = device_get_binding(DT_LABEL(GPIO0_NID));
+    if (gpio0_dev == NULL) {
+        printk("Error: Failed to bind to GPIO0\n\r");        
+	return -ENODEV;
+    }
+    else {
+        printk("Bind to GPIO0 successfull \n\r");        
+    }
+    
+    ret = pwm_out_init();
+    if (ret < 0) {
+	printk("Error: Failed to bind to PWM0\n r");
+	return ret;
+    }
+    else  {
+        printk("Bind to PWM0 successful\n\r");            
+    }
+
+    
+    /* Configure PINS */    
+    
+    /* Note that PCB does not include pull-up resistors */
+    /* See nRF52840v1.0.0 DK Users Guide V 1.0.0, pg 29 */
+    ret = gpio_pin_configure(gpio0_dev, BOARDBUT1, GPIO_INPUT | GPIO_PULL_UP);
+    if (ret < 0) {
+        printk("Error %d: Failed to configure BUT 1 \n\r", ret);
+	return ret;
+    }
+
+#if defined(CONFIG_APP_GESTURE)
+    /* Gestures of all four buttons, recognized from their debounced edges */
+    gesture_init(button_gesture);
+    for (size_t i = 0; i < ARRAY_SIZE(gesture_buttons); i++) {
+        /* Active low, so that a press is the active state */
+        ret = gpio_pin_configure(gpio0_dev, gesture_buttons[i].pin,
+                                 GPIO_INPUT | GPIO_PULL_UP | GPIO_ACTIVE_LOW);
+        if (ret < 0) {
+            printk("Error %d: Failed to configure BUT %u \n\r", ret, i + 1);
+            return ret;
+        }
+        ret = gesture_add(gpio0_dev, gesture_buttons[i].pin, gesture_buttons[i].options);
+        if (ret < 0) {
+            printk("Error %d: failed to set up gestures on BUT %u \n\r", ret, i + 1);
+            return ret;
+        }
+    }
+    printk("Hold But2 to set the clock (But3/But4: +/-, But2: next)\n\r");
+#elif defined(CONFIG_APP_DEBOUNCE)
+    /* Edge interrupts only start the shared sampling timer; the press is
+     * reported once the contacts have settled. Active low, so that a press
+     * is the active state */
+    ret = gpio_pin_configure(gpio0_dev, BOARDBUT1, GPIO_INPUT | GPIO_PULL_UP | GPIO_ACTIVE_LOW);
+    if (ret < 0) {
+        printk("Error %d: Failed to configure BUT 1 \n\r", ret);
+	return ret;
+    }
+    ret = debounce_add(&but1_input, gpio0_dev, BOARDBUT1,
+                       CONFIG_APP_DEBOUNCE_THRESHOLD, but1_debounced);
+    if (ret != 0) {
+	printk("Error %d: failed to set up debouncing on BUT1 pin \n\r", ret);
+	return ret;
+    }
+#else
+    /* Set interrupt HW - which pin and event generate interrupt */
+    ret = gpio_pin_interrupt_configure(gpio0_dev, BOARDBUT1, GPIO_INT_EDGE_TO_ACTIVE);
+    if (ret != 0) {
+	printk("Error %d: failed to configure interrupt on BUT1 pin \n\r", ret);
+	return ret;
+    }
+    
+    /* Set callback */
+    gpio_init_callback(&but1_cb_data, but1press_cbfunction, BIT(BOARDBUT1));
+    gpio_add_callback(gpio0_dev, &but1_cb_data);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Manual control: buttons, commands and signals driving the LED PWM
+ *
+ * All input sources of the manual control are serviced by one consumer
+ * (the manual thread, or the application work queue in event-driven mode):
+ *  - button events (semaphore, given from the button callback)
+ *  - commands (FIFO), e.g. from the UART command interface
+ *  - signal bits (poll signal), e.g. from timers and alarms
+ * In threaded mode the consumer waits on all of them with a single k_poll
+ * and handles every ready event before blocking again.
+ */
+
+#ifndef MANUAL_H
+#define MANUAL_H
+
+#include <zephyr.h>
+
+enum manual_cmd_type {
+    MANUAL_CMD_STEP,        /* Advance to the next intensity, like BUT1 */
+    MANUAL_CMD_SET_DUTY,    /* Set "permille" on the LED at "pin" */
+    MANUAL_CMD_GESTURE,     /* "gesture" recognized on DK button "button" */
+};
+
+struct manual_cmd {
+    enum manual_cmd_type type;
+    uint32_t pin;
+    uint16_t permille;
+    uint8_t button;         /* 0..3 for BUT1..BUT4 */
+    uint8_t gesture;        /* enum gesture */
+};
+
+/* "pin" of MANUAL_CMD_SET_DUTY addressing the LED stepped by BUT1 */
+#define MANUAL_PIN_LED UINT32_MAX
+
+/* Signal bits, see manual_signal() */
+#define MANUAL_SIG_STEP BIT(0)      /* Advance to the next intensity */
+
+/* Bind devices and configure the buttons. "notify", if not NULL, is called
+ * (possibly from ISR context) whenever an event becomes ready; used when
+ * the consumer is a work item rather than a thread blocked in manual_wait().
+ * Returns 0 or negative errno. */
+int manual_init(void (*notify)(void));
+
+/* Block until at least one input source has an event ready */
+void manual_wait(void);
+
+/* Handle all ready events without blocking. Returns 0 or the last error */
+int manual_process(void);
+
+/* Queue a command (copied). ISR safe. Returns 0 or -ENOMEM if the command
+ * pool is exhausted */
+int manual_post(const struct manual_cmd *cmd);
+
+/* Raise signal bits (OR-ed until handled). ISR safe */
+void manual_signal(uint32_t bits);
+
+#endif /* MANUAL_H */
@@ -0,0 +1,112 @@
+/*
+ * Metrics registry: export
+ *
+ * Walks the linker-collected descriptors; nothing here is on the update
+ * path. The layout hash (FNV-1a folded to 16 bits) only depends on the
+ * build, so it is computed once.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <sys/byteorder.h>
+#include <string.h>
+#include <errno.h>
+
+#include "metrics.h"
+
+static const char *const type_names[] = { "counter", "gauge", "histogram" };
+
+static uint16_t layout;
+
+static uint32_t fnv1a(uint32_t h, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619U;
+    }
+
+    return h;
+}
+
+uint16_t metrics_layout(void)
+{
+    uint32_t h = 2166136261U;
+
+    if (layout != 0) {
+        return layout;
+    }
+    STRUCT_SECTION_FOREACH(metric, m) {
+        h = fnv1a(h, m->name, strlen(m->name) + 1);
+        h = fnv1a(h, &m->type, sizeof(m->type));
+        h = fnv1a(h, &m->n_values, sizeof(m->n_values));
+    }
+    /* 0 means "not computed yet" */
+    layout = (uint16_t)((h >> 16) ^ h) | 1;
+
+    return layout;
+}
+
+size_t metrics_frame_size(void)
+{
+    size_t size = sizeof(struct metrics_frame_hdr);
+
+    STRUCT_SECTION_FOREACH(metric, m) {
+        size += m->n_values * sizeof(uint32_t);
+    }
+
+    return size;
+}
+
+int metrics_export(uint8_t *buf, size_t len)
+{
+    struct metrics_frame_hdr hdr = {
+        .version = METRICS_FRAME_VERSION,
+        .layout = sys_cpu_to_le16(metrics_layout()),
+        .uptime_ms = sys_cpu_to_le32(k_uptime_get_32()),
+    };
+    size_t pos = sizeof(hdr);
+    unsigned int n = 0;
+
+    if (len < metrics_frame_size()) {
+        return -ENOMEM;
+    }
+
+    STRUCT_SECTION_FOREACH(metric, m) {
+        for (int i = 0; i < m->n_values; i++) {
+            sys_put_le32((uint32_t)atomic_get(&m->values[i]), &buf[pos]);
+            pos += sizeof(uint32_t);
+        }
+        n++;
+    }
+    hdr.n_metrics = (uint8_t)n;
+    memcpy(buf, &hdr, sizeof(hdr));
+
+    return (int)pos;
+}
+
+void metrics_describe(void)
+{
+    unsigned int i = 0;
+
+    printk("metrics layout %04x, frame %u bytes\n\r", metrics_layout(),
+           (unsigned int)metrics_frame_size());
+    STRUCT_SECTION_FOREACH(metric, m) {
+        printk("    %2u %-20s %s %u\n\r", i++, m->name, type_names[m->type], m->n_values);
+    }
+}
+
+void metrics_dump(void)
+{
+    STRUCT_SECTION_FOREACH(metric, m) {
+        if (m->type != METRIC_HISTOGRAM) {
+            printk("%-20s %u\n\r", m->name, (uint32_t)atomic_get(&m->values[0]));
+            continue;
+        }
+        printk("%-20s", m->name);
+        for (int i = 0; i < m->n_values; i++) {
+            printk(" %u", (uint32_t)atomic_get(&m->values[i]));
+        }
+        printk("\n\r");
+    }
+}
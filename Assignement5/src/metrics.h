@@ -0,0 +1,121 @@
+/*
+ * Metrics registry
+ *
+ * Modules define their metrics statically; the descriptors are collected
+ * by the linker into one iterable section (metrics.ld), so there is no
+ * registration at runtime and no central list to maintain. Every update
+ * is a single atomic operation on the metric's own storage: lock-free and
+ * safe from any context, including ISRs.
+ *
+ *   METRIC_COUNTER_DEFINE(button_presses);
+ *   ...
+ *   metric_inc(METRIC(button_presses));
+ *
+ * Metric kinds:
+ *  - counter: monotonic, metric_inc() / metric_add()
+ *  - gauge: last value, metric_set()
+ *  - histogram: "n" log2 buckets, metric_observe(). Bucket 0 counts the
+ *    value 0, bucket i the values in [2^(i-1), 2^i); the last bucket also
+ *    takes everything above.
+ *
+ * The export order is the linker's: sorted by metric name.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <zephyr.h>
+#include <sys/atomic.h>
+
+enum metric_type {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM,
+};
+
+/* Descriptor, in flash. The values live in RAM */
+struct metric {
+    const char *name;
+    atomic_t *values;
+    uint8_t type;           /* enum metric_type */
+    uint8_t n_values;       /* 1, or the number of histogram buckets */
+};
+
+#define METRIC(name) (&_metric_##name)
+
+#define Z_METRIC_DEFINE(_name, _type, _n)                                   \
+    static atomic_t _metric_values_##_name[_n];                             \
+    const STRUCT_SECTION_ITERABLE(metric, _metric_##_name) = {              \
+        .name = #_name,                                                     \
+        .values = _metric_values_##_name,                                   \
+        .type = _type,                                                      \
+        .n_values = _n,                                                     \
+    }
+
+#define METRIC_COUNTER_DEFINE(name) Z_METRIC_DEFINE(name, METRIC_COUNTER, 1)
+#define METRIC_GAUGE_DEFINE(name) Z_METRIC_DEFINE(name, METRIC_GAUGE, 1)
+#define METRIC_HISTOGRAM_DEFINE(name, n)                                    \
+    BUILD_ASSERT((n) >= 2 && (n) <= 33, "2 to 33 log2 buckets");           \
+    Z_METRIC_DEFINE(name, METRIC_HISTOGRAM, n)
+
+/* Use a metric defined in another file */
+#define METRIC_DECLARE(name) extern const struct metric _metric_##name
+
+static inline void metric_inc(const struct metric *m)
+{
+    atomic_inc(&m->values[0]);
+}
+
+static inline void metric_add(const struct metric *m, uint32_t n)
+{
+    atomic_add(&m->values[0], (atomic_val_t)n);
+}
+
+static inline void metric_set(const struct metric *m, uint32_t value)
+{
+    atomic_set(&m->values[0], (atomic_val_t)value);
+}
+
+/* Value of a counter or gauge */
+static inline uint32_t metric_get(const struct metric *m)
+{
+    return (uint32_t)atomic_get(&m->values[0]);
+}
+
+static inline void metric_observe(const struct metric *m, uint32_t value)
+{
+    uint32_t bucket = (value != 0) ? 32 - __builtin_clz(value) : 0;
+
+    atomic_inc(&m->values[MIN(bucket, m->n_values - 1U)]);
+}
+
+/* Binary snapshot: this header, then every value of every metric as a
+ * little-endian uint32, in export order. Each value is read atomically,
+ * but the frame as a whole is not a consistent cut. "layout" is a hash of
+ * the metric names, kinds and sizes, identifying the order for a decoder
+ * holding the matching metrics_describe() output */
+struct metrics_frame_hdr {
+    uint8_t version;
+    uint8_t n_metrics;
+    uint16_t layout;
+    uint32_t uptime_ms;
+} __packed;
+
+#define METRICS_FRAME_VERSION 1
+
+/* Write a snapshot to "buf". Returns its length or -ENOMEM */
+int metrics_export(uint8_t *buf, size_t len);
+
+/* Layout hash of the snapshots */
+uint16_t metrics_layout(void);
+
+/* Size of a snapshot */
+size_t metrics_frame_size(void);
+
+/* Print the layout of the binary frame (index, name, kind, size) */
+void metrics_describe(void);
+
+/* Print every metric */
+void metrics_dump(void);
+
+#endif /* METRICS_H */
@@ -0,0 +1,223 @@
+/*
+ * Power policy
+ *
+ * The nRF52 clock tree starts the HF clock on demand: any peripheral that
+ * needs it (a PWM generating pulses, a UARTE receiving, a running TIMER)
+ * keeps it on, and with it a few hundred uA up to about 1 mA with the
+ * crystal. The CPU itself sleeps in the idle thread (WFE) whatever the
+ * peripherals do, so the HF users decide the idle current.
+ *
+ * This module keeps one vote bit per HF user and accounts, in kernel
+ * ticks, the time spent in each state and by each user. With
+ * APP_POWER_HFXO the first vote also requests the crystal oscillator
+ * from the clock control driver, and the last release gives it back;
+ * otherwise the peripherals run from the internal RC oscillator, which
+ * the hardware starts and stops by itself.
+ *
+ * UARTE instances enabled in the devicetree keep their receiver, and so
+ * the HF clock, running from boot. All but the console, the time
+ * synchronization link and the telemetry UART are suspended; these hold
+ * their HF vote for good. Without commands and printk (release profile)
+ * the console only carries the event ring dump, which is done before
+ * power_init(), so it is suspended too.
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <devicetree.h>
+#include <pm/device.h>
+#include <spinlock.h>
+#include <sys/printk.h>
+#include <string.h>
+#include <errno.h>
+
+#include "power.h"
+
+#if defined(CONFIG_APP_POWER_HFXO)
+#include <drivers/clock_control.h>
+#include <drivers/clock_control/nrf_clock_control.h>
+
+static struct onoff_client hfxo_cli;
+#endif
+
+static struct k_spinlock power_lock;
+static uint32_t hf_users;                       /* One bit per enum power_hf_user */
+static int64_t since[POWER_HF_USERS];           /* Tick of the user's last get */
+static int64_t state_since;                     /* Tick of the last state change (boot) */
+static int64_t state_ticks[POWER_STATES];
+static int64_t user_ticks[POWER_HF_USERS];
+static uint32_t transitions;
+
+static const char *const state_names[POWER_STATES] = { "LF only", "HF" };
+static const char *const user_names[POWER_HF_USERS] = {
+    "pwm", "pwm_stream", "console", "tsync", "telem", "edge_count",
+};
+
+static inline enum power_state state_of(uint32_t users)
+{
+    return (users != 0) ? POWER_STATE_HF : POWER_STATE_LF;
+}
+
+static void hfxo_request(bool on)
+{
+#if defined(CONFIG_APP_POWER_HFXO)
+    struct onoff_manager *mgr =
+        z_nrf_clock_control_get_onoff(CLOCK_CONTROL_NRF_SUBSYS_HF);
+
+    if (on) {
+        sys_notify_init_spinwait(&hfxo_cli.notify);
+        onoff_request(mgr, &hfxo_cli);
+    } else {
+        onoff_cancel_or_release(mgr, &hfxo_cli);
+    }
+#endif
+}
+
+/* Called with power_lock held */
+static void state_change(uint32_t users, int64_t now)
+{
+    enum power_state old = state_of(hf_users);
+    enum power_state new = state_of(users);
+
+    hf_users = users;
+    if (new == old) {
+        return;
+    }
+    state_ticks[old] += now - state_since;
+    state_since = now;
+    transitions++;
+    hfxo_request(new == POWER_STATE_HF);
+}
+
+void power_hf_get(enum power_hf_user user)
+{
+    k_spinlock_key_t key = k_spin_lock(&power_lock);
+    int64_t now = k_uptime_ticks();
+
+    if (!(hf_users & BIT(user))) {
+        since[user] = now;
+        state_change(hf_users | BIT(user), now);
+    }
+    k_spin_unlock(&power_lock, key);
+}
+
+void power_hf_put(enum power_hf_user user)
+{
+    k_spinlock_key_t key = k_spin_lock(&power_lock);
+    int64_t now = k_uptime_ticks();
+
+    if (hf_users & BIT(user)) {
+        user_ticks[user] += now - since[user];
+        state_change(hf_users & ~BIT(user), now);
+    }
+    k_spin_unlock(&power_lock, key);
+}
+
+enum power_state power_state_get(void)
+{
+    return state_of(hf_users);
+}
+
+void power_stats_get(struct power_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&power_lock);
+    int64_t now = k_uptime_ticks();
+    enum power_state cur = state_of(hf_users);
+
+    for (int i = 0; i < POWER_STATES; i++) {
+        int64_t t = state_ticks[i];
+
+        if (i == (int)cur) {
+            t += now - state_since;
+        }
+        stats->state_ms[i] = k_ticks_to_ms_floor64(t);
+    }
+    for (int i = 0; i < POWER_HF_USERS; i++) {
+        int64_t t = user_ticks[i];
+
+        if (hf_users & BIT(i)) {
+            t += now - since[i];
+        }
+        stats->user_ms[i] = k_ticks_to_ms_floor64(t);
+    }
+    stats->transitions = transitions;
+    k_spin_unlock(&power_lock, key);
+}
+
+/* Share of "part" in "total", in permille */
+static uint32_t permille(int64_t part, int64_t total)
+{
+    return (total > 0) ? (uint32_t)(part * 1000 / total) : 0;
+}
+
+void power_dump(void)
+{
+    struct power_stats s;
+    int64_t total = 0;
+
+    power_stats_get(&s);
+    for (int i = 0; i < POWER_STATES; i++) {
+        total += s.state_ms[i];
+    }
+
+    printk("power: %u transitions, now %s\n\r", s.transitions,
+           state_names[power_state_get()]);
+    for (int i = 0; i < POWER_STATES; i++) {
+        uint32_t pm = permille(s.state_ms[i], total);
+
+        printk("    %-12s %u.%03u s %u.%u%%\n\r", state_names[i],
+               (uint32_t)(s.state_ms[i] / 1000), (uint32_t)(s.state_ms[i] % 1000),
+               pm / 10, pm % 10);
+    }
+    for (int i = 0; i < POWER_HF_USERS; i++) {
+        uint32_t pm = permille(s.user_ms[i], total);
+
+        printk("    hf %-9s %u.%03u s %u.%u%%\n\r", user_names[i],
+               (uint32_t)(s.user_ms[i] / 1000), (uint32_t)(s.user_ms[i] % 1000),
+               pm / 10, pm % 10);
+    }
+}
+
+#define POWER_UART_DEV(node) DEVICE_DT_GET(node),
+
+static const struct device *const uarts[] = {
+    DT_FOREACH_STATUS_OKAY(nordic_nrf_uarte, POWER_UART_DEV)
+};
+
+int power_init(void)
+{
+    const struct device *console = DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
+    int ret = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(uarts); i++) {
+        int err;
+
+        if (!device_is_ready(uarts[i])) {
+            continue;
+        }
+        if (uarts[i] == console &&
+            (IS_ENABLED(CONFIG_APP_CMD) || IS_ENABLED(CONFIG_PRINTK))) {
+            power_hf_get(POWER_HF_CONSOLE);
+            continue;
+        }
+#if defined(CONFIG_APP_TSYNC)
+        if (strcmp(uarts[i]->name, CONFIG_APP_TSYNC_UART) == 0) {
+            power_hf_get(POWER_HF_TSYNC);
+            continue;
+        }
+#endif
+#if defined(CONFIG_APP_TELEM)
+        if (strcmp(uarts[i]->name, CONFIG_APP_TELEM_UART) == 0) {
+            power_hf_get(POWER_HF_TELEM);
+            continue;
+        }
+#endif
+        err = pm_device_state_set(uarts[i], PM_DEVICE_STATE_SUSPENDED);
+        if (err != 0 && err != -EALREADY) {
+            printk("Error %d: failed to suspend %s\n\r", err, uarts[i]->name);
+            ret = err;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,58 @@
+/*
+ * Power policy
+ *
+ * Peripherals that need the high-frequency clock (a running PWM pulls it
+ * in whenever it generates pulses) declare it with power_hf_get() and
+ * drop it with power_hf_put(). The policy keeps the HF clock vote, and the
+ * time spent with and without it, per user. UART instances the
+ * application does not use are suspended at init; those it keeps hold a
+ * vote from then on, as their receivers keep the HF clock running.
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <zephyr.h>
+
+/* Users of the high-frequency clock */
+enum power_hf_user {
+    POWER_HF_PWM,           /* LED PWM (PWM0) generating pulses */
+    POWER_HF_PWM_STREAM,    /* Streaming PWM (PWM1) playing */
+    POWER_HF_CONSOLE,       /* Console UARTE receiver */
+    POWER_HF_TSYNC,         /* Time synchronization UARTE receiver */
+    POWER_HF_TELEM,         /* Telemetry UARTE */
+    POWER_HF_EDGE_COUNT,    /* Edge counter hardware path (GPIOTE IN, TIMER1) */
+    POWER_HF_USERS
+};
+
+/* Power states, by what the clock tree has to keep running */
+enum power_state {
+    POWER_STATE_LF,         /* Only the 32 kHz clock (RTC, GPIOTE port events) */
+    POWER_STATE_HF,         /* Some peripheral holds the HF clock */
+    POWER_STATES
+};
+
+struct power_stats {
+    int64_t state_ms[POWER_STATES];     /* Time spent in each state */
+    int64_t user_ms[POWER_HF_USERS];    /* Time each user held the HF clock */
+    uint32_t transitions;               /* LF <-> HF switches */
+};
+
+/* Suspend the unused UARTs and start the accounting */
+int power_init(void);
+
+/* Declare / release the HF clock need of "user". Both are idempotent and
+ * callable from ISRs */
+void power_hf_get(enum power_hf_user user);
+void power_hf_put(enum power_hf_user user);
+
+/* Current state */
+enum power_state power_state_get(void);
+
+/* Accumulated times, up to now */
+void power_stats_get(struct power_stats *stats);
+
+/* Print the time shares */
+void power_dump(void);
+
+#endif /* POWER_H */
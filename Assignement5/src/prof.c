@@ -0,0 +1,150 @@
+/*
+ * Statistical PC-sampling profiler
+ *
+ * TIMER4 interrupts at CONFIG_APP_PROF_RATE_HZ with the highest priority.
+ * When the interrupt preempted thread mode (ICSR.RETTOBASE set), the
+ * interrupted PC is at offset 24 of the exception frame on the process
+ * stack, which all Zephyr threads (idle included) run on. Otherwise an ISR
+ * was preempted and the sample is counted as PROF_PC_ISR.
+ *
+ * Histogram mode: the text section is split into at most
+ * CONFIG_APP_PROF_HIST_BUCKETS power-of-two sized buckets, picked at init
+ * from the actual text size. PCs outside it (e.g. RAM functions) are
+ * counted apart.
+ *
+ * RTT mode: each sample is written as a little-endian 32-bit PC to up
+ * buffer CONFIG_APP_PROF_RTT_CHANNEL in non-blocking skip mode; a sample
+ * that does not fit is dropped and counted. This ISR is the only writer of
+ * the channel, so the unlocked write is safe.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <linker/linker-defs.h>
+#include <soc.h>
+#include <hal/nrf_timer.h>
+#if defined(CONFIG_APP_PROF_RTT)
+#include <SEGGER_RTT.h>
+#endif
+
+#include "prof.h"
+
+#define PROF_TIMER NRF_TIMER4
+#define PROF_TIMER_HZ 1000000
+#define PROF_IRQ_PRIO 0
+#define HIST_BUCKETS CONFIG_APP_PROF_HIST_BUCKETS
+
+BUILD_ASSERT(CONFIG_APP_PROF_RATE_HZ <= PROF_TIMER_HZ / 10, "Sampling rate too high");
+
+static uint32_t samples;
+static uint32_t isr_samples;
+static uint32_t other_samples;      /* Outside the histogram / dropped in RTT mode */
+
+#if defined(CONFIG_APP_PROF_RTT)
+static uint8_t rtt_buf[CONFIG_APP_PROF_RTT_BUF_SIZE];
+#else
+static uint32_t hist[HIST_BUCKETS];
+static uint32_t hist_base;
+static uint32_t hist_shift;
+#endif
+
+static inline void prof_record(uint32_t pc)
+{
+    samples++;
+    if (pc == PROF_PC_ISR) {
+        isr_samples++;
+    }
+
+#if defined(CONFIG_APP_PROF_RTT)
+    if (SEGGER_RTT_WriteSkipNoLock(CONFIG_APP_PROF_RTT_CHANNEL, &pc, sizeof(pc)) == 0) {
+        other_samples++;
+    }
+#else
+    uint32_t idx = (pc - hist_base) >> hist_shift;
+
+    if (pc == PROF_PC_ISR) {
+        return;
+    } else if (idx < HIST_BUCKETS) {
+        hist[idx]++;
+    } else {
+        other_samples++;
+    }
+#endif
+}
+
+static void prof_isr(const void *arg)
+{
+    uint32_t pc = PROF_PC_ISR;
+
+    nrf_timer_event_clear(PROF_TIMER, NRF_TIMER_EVENT_COMPARE0);
+
+    if (SCB->ICSR & SCB_ICSR_RETTOBASE_Msk) {
+        pc = ((const uint32_t *)__get_PSP())[6];
+    }
+    prof_record(pc);
+}
+
+int prof_init(void)
+{
+#if defined(CONFIG_APP_PROF_RTT)
+    SEGGER_RTT_ConfigUpBuffer(CONFIG_APP_PROF_RTT_CHANNEL, "prof", rtt_buf,
+                              sizeof(rtt_buf), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+#else
+    uint32_t size = (uint32_t)(__text_region_end - __text_region_start);
+
+    hist_base = (uint32_t)__text_region_start;
+    hist_shift = 0;
+    while ((size >> hist_shift) >= HIST_BUCKETS) {
+        hist_shift++;
+    }
+#endif
+
+    nrf_timer_mode_set(PROF_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(PROF_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_frequency_set(PROF_TIMER, NRF_TIMER_FREQ_1MHz);
+    nrf_timer_cc_set(PROF_TIMER, NRF_TIMER_CC_CHANNEL0,
+                     PROF_TIMER_HZ / CONFIG_APP_PROF_RATE_HZ);
+    nrf_timer_shorts_enable(PROF_TIMER, NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK);
+    nrf_timer_int_enable(PROF_TIMER, NRF_TIMER_INT_COMPARE0_MASK);
+
+    IRQ_CONNECT(TIMER4_IRQn, PROF_IRQ_PRIO, prof_isr, NULL, 0);
+    irq_enable(TIMER4_IRQn);
+
+    prof_start();
+
+    return 0;
+}
+
+void prof_start(void)
+{
+    nrf_timer_task_trigger(PROF_TIMER, NRF_TIMER_TASK_START);
+}
+
+void prof_stop(void)
+{
+    nrf_timer_task_trigger(PROF_TIMER, NRF_TIMER_TASK_STOP);
+}
+
+void prof_dump(void)
+{
+    prof_stop();
+
+#if defined(CONFIG_APP_PROF_RTT)
+    printk("prof: %u samples, %u in ISRs, %u dropped (RTT channel %d)\n\r",
+           samples, isr_samples, other_samples, CONFIG_APP_PROF_RTT_CHANNEL);
+#else
+    printk("prof: %u samples, %u in ISRs, %u outside text, base 0x%08x, "
+           "bucket %u bytes\n\r", samples, isr_samples, other_samples,
+           hist_base, 1u << hist_shift);
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        if (hist[i] != 0) {
+            printk("prof 0x%08x %u\n\r", hist_base + (i << hist_shift), hist[i]);
+            hist[i] = 0;
+        }
+    }
+    printk("prof end\n\r");
+#endif
+
+    samples = isr_samples = other_samples = 0;
+    prof_start();
+}
@@ -0,0 +1,31 @@
+/*
+ * Statistical PC-sampling profiler
+ *
+ * A high-priority timer interrupt samples the program counter of the
+ * interrupted thread. Samples are either accumulated in a histogram over
+ * the text section (dumped as text with prof_dump()) or streamed raw
+ * through a SEGGER RTT up-buffer. scripts/prof_report.py resolves either
+ * form against zephyr.elf into a per-function profile.
+ */
+
+#ifndef PROF_H
+#define PROF_H
+
+#include <zephyr/types.h>
+
+/* Samples taken while another interrupt was active; the stacked PC then
+ * belongs to an ISR and is not resolved */
+#define PROF_PC_ISR 0x00000000u
+
+/* Start sampling at CONFIG_APP_PROF_RATE_HZ. Returns 0 */
+int prof_init(void);
+
+/* Pause and resume sampling (the histogram is kept) */
+void prof_stop(void);
+void prof_start(void);
+
+/* Print the histogram ("prof 0x<addr> <count>" lines) and clear it.
+ * In RTT mode, prints the sample and drop counts only */
+void prof_dump(void);
+
+#endif /* PROF_H */
@@ -0,0 +1,136 @@
+/*
+ * Coalescing PWM command queue
+ *
+ * The queue is a ring of atomic words, one per command: a full flag, the
+ * channel and the duty-cycle. Producers claim a position by advancing
+ * "enq_pos" with compare-and-swap, after checking against "deq_pos" that
+ * the slot has been consumed, then publish the command with a single
+ * atomic store and wake the consumer. No producer ever waits on another:
+ * a producer preempted between claim and store only holds back the
+ * consumer, which stops at the first slot not yet published and is woken
+ * again by that producer's store.
+ *
+ * The consumer is the only writer of "deq_pos" and of emptied slots. Each
+ * pass drains at most one ring's worth of commands, so continuous posting
+ * cannot starve the PWM update, then applies the latest duty-cycle of
+ * each channel seen and waits for the PWM to load it (pwm_out_sync()).
+ * Commands posted meanwhile are coalesced in the next pass.
+ */
+
+#include <zephyr.h>
+#include <sys/atomic.h>
+#include <errno.h>
+
+#include "pwm_cmd.h"
+#include "pwm_out.h"
+#include "metrics.h"
+
+#define PWM_CMD_STACK_SIZE 1024
+#define PWM_CMD_PRIO 2                  /* Just below the application threads */
+#define QUEUE_SIZE CONFIG_APP_PWM_CMD_QUEUE_SIZE
+#define QUEUE_MASK (QUEUE_SIZE - 1)
+
+BUILD_ASSERT((QUEUE_SIZE & QUEUE_MASK) == 0, "Queue size must be a power of two");
+
+/* Slot: full flag, channel in bits 16..23, permille in bits 0..15 */
+#define SLOT_FULL BIT(31)
+#define SLOT_CMD(ch, permille) (SLOT_FULL | ((uint32_t)(ch) << 16) | (permille))
+#define SLOT_CHANNEL(v) (((v) >> 16) & 0xff)
+#define SLOT_PERMILLE(v) ((uint16_t)((v) & 0xffff))
+
+static atomic_t queue[QUEUE_SIZE];
+static atomic_t enq_pos;                /* Next position to claim */
+static atomic_t deq_pos;                /* Next position to consume */
+static K_SEM_DEFINE(pwm_cmd_sem, 0, 1);
+
+METRIC_COUNTER_DEFINE(pwm_cmd_posted);
+METRIC_COUNTER_DEFINE(pwm_cmd_overflows);
+METRIC_COUNTER_DEFINE(pwm_cmd_coalesced);
+METRIC_COUNTER_DEFINE(pwm_cmd_applied);
+METRIC_COUNTER_DEFINE(pwm_cmd_frames);
+
+int pwm_cmd_post(uint32_t pin, uint16_t permille)
+{
+    int ch = pwm_out_channel(pin);
+    atomic_val_t pos;
+
+    if (ch < 0 || permille > 1000) {
+        return -EINVAL;
+    }
+
+    do {
+        pos = atomic_get(&enq_pos);
+        if ((uint32_t)(pos - atomic_get(&deq_pos)) >= QUEUE_SIZE) {
+            metric_inc(METRIC(pwm_cmd_overflows));
+            return -ENOBUFS;
+        }
+    } while (!atomic_cas(&enq_pos, pos, pos + 1));
+
+    atomic_set(&queue[pos & QUEUE_MASK], (atomic_val_t)SLOT_CMD(ch, permille));
+    metric_inc(METRIC(pwm_cmd_posted));
+    k_sem_give(&pwm_cmd_sem);
+
+    return 0;
+}
+
+/* Take the oldest published command. Consumer only */
+static bool pwm_cmd_get(uint32_t *cmd)
+{
+    atomic_val_t pos = atomic_get(&deq_pos);
+    atomic_t *slot = &queue[pos & QUEUE_MASK];
+    uint32_t v = (uint32_t)atomic_get(slot);
+
+    if (!(v & SLOT_FULL)) {
+        return false;
+    }
+    atomic_set(slot, 0);
+    atomic_set(&deq_pos, pos + 1);
+    *cmd = v;
+
+    return true;
+}
+
+void pwm_cmd_stats_get(struct pwm_cmd_stats *stats)
+{
+    stats->posted = metric_get(METRIC(pwm_cmd_posted));
+    stats->overflows = metric_get(METRIC(pwm_cmd_overflows));
+    stats->coalesced = metric_get(METRIC(pwm_cmd_coalesced));
+    stats->applied = metric_get(METRIC(pwm_cmd_applied));
+    stats->frames = metric_get(METRIC(pwm_cmd_frames));
+}
+
+static void pwm_cmd_thread_code(void *argA, void *argB, void *argC)
+{
+    uint16_t permille[PWM_OUT_CHANNELS];
+    uint32_t mask;
+    uint32_t cmd;
+
+    while (1) {
+        k_sem_take(&pwm_cmd_sem, K_FOREVER);
+
+        mask = 0;
+        for (int n = 0; n < QUEUE_SIZE && pwm_cmd_get(&cmd); n++) {
+            uint32_t ch = SLOT_CHANNEL(cmd);
+
+            if (mask & BIT(ch)) {
+                metric_inc(METRIC(pwm_cmd_coalesced));
+            }
+            mask |= BIT(ch);
+            permille[ch] = SLOT_PERMILLE(cmd);
+        }
+        if (mask == 0) {
+            /* Woken by a producer whose slot is not published yet */
+            continue;
+        }
+
+        pwm_out_set_duties(permille, mask);
+        metric_add(METRIC(pwm_cmd_applied), (uint32_t)__builtin_popcount(mask));
+        metric_inc(METRIC(pwm_cmd_frames));
+
+        /* What is posted meanwhile is coalesced in the next pass */
+        pwm_out_sync();
+    }
+}
+
+K_THREAD_DEFINE(pwm_cmd_thread, PWM_CMD_STACK_SIZE, pwm_cmd_thread_code, NULL, NULL, NULL,
+                PWM_CMD_PRIO, 0, 0);
@@ -0,0 +1,33 @@
+/*
+ * Coalescing PWM command queue
+ *
+ * Duty-cycle updates from any number of producers (buttons, commands,
+ * alarms, ISRs) are posted to a bounded lock-free queue and applied by one
+ * thread. The thread takes everything pending, keeps the latest update of
+ * each channel and applies the changed channels in a single pwm_out
+ * update, then waits for the PWM to load it: at most one driver call per
+ * PWM period, however bursty the producers.
+ */
+
+#ifndef PWM_CMD_H
+#define PWM_CMD_H
+
+#include <zephyr.h>
+
+struct pwm_cmd_stats {
+    uint32_t posted;        /* Updates queued */
+    uint32_t overflows;     /* Updates refused, the queue being full */
+    uint32_t coalesced;     /* Updates superseded before being applied */
+    uint32_t applied;       /* Channel updates applied */
+    uint32_t frames;        /* pwm_out updates (driver calls) */
+};
+
+/* Queue a duty-cycle (permille) for the PWM output at "pin". Lock-free
+ * and safe from any context, including ISRs. Returns 0, -EINVAL or
+ * -ENOBUFS if the queue is full */
+int pwm_cmd_post(uint32_t pin, uint16_t permille);
+
+/* Copy the statistics */
+void pwm_cmd_stats_get(struct pwm_cmd_stats *stats);
+
+#endif /* PWM_CMD_H */
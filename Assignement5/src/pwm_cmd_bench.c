@@ -0,0 +1,179 @@
+/*
+ * PWM command queue burst benchmark
+ *
+ * Two producer threads above the queue's consumer and a k_timer (ISR)
+ * post duty-cycle updates to random LED channels. The threads post in
+ * bursts of "burst" updates, one burst each every BURST_GAP_MS; the timer
+ * posts one update every TIMER_US throughout. For each burst size, once
+ * the queue has drained, prints the updates posted and refused, how many
+ * were coalesced, applied and in how many pwm_out updates (driver calls,
+ * versus one per update without the queue), and the pwm_cmd_post() cost.
+ * Runs in a low-priority thread once the application is up; all channels
+ * are put back to their duty-cycles from before the bench.
+ */
+
+#include <zephyr.h>
+#include <devicetree.h>
+#include <sys/printk.h>
+#include <timing/timing.h>
+
+#include "pwm_cmd.h"
+#include "pwm_out.h"
+
+#define BENCH_PRODUCERS 2
+#define BENCH_BURSTS 32
+#define BURST_GAP_MS 5
+#define TIMER_US 500
+#define BENCH_STACK_SIZE 1024
+#define BENCH_PRIO 3                /* Below the queue's consumer */
+#define PRODUCER_PRIO 1             /* Above it */
+#define BENCH_START_MS 3000
+#define DRAIN_TIMEOUT_MS 1000
+
+static const uint32_t bench_pins[PWM_OUT_CHANNELS] = {
+    DT_GPIO_PIN(DT_NODELABEL(led0), gpios),
+    DT_GPIO_PIN(DT_NODELABEL(led1), gpios),
+    DT_GPIO_PIN(DT_NODELABEL(led2), gpios),
+    DT_GPIO_PIN(DT_NODELABEL(led3), gpios),
+};
+
+/* pwm_cmd_post() cost, per producer (the last one is the timer) */
+struct post_cost {
+    uint64_t sum_cycles;
+    uint64_t max_cycles;
+    uint32_t n;
+    uint32_t seed;
+};
+
+static struct post_cost costs[BENCH_PRODUCERS + 1];
+static K_THREAD_STACK_ARRAY_DEFINE(producer_stacks, BENCH_PRODUCERS, BENCH_STACK_SIZE);
+static struct k_thread producer_threads[BENCH_PRODUCERS];
+
+/* Small LCG: deterministic pattern across runs */
+static uint32_t bench_rand(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static void post_one(struct post_cost *c)
+{
+    uint32_t r = bench_rand(&c->seed);
+    timing_t t0, t1;
+    uint64_t cycles;
+
+    t0 = timing_counter_get();
+    (void)pwm_cmd_post(bench_pins[r % PWM_OUT_CHANNELS], (uint16_t)((r >> 4) % 1001));
+    t1 = timing_counter_get();
+
+    cycles = timing_cycles_get(&t0, &t1);
+    c->sum_cycles += cycles;
+    c->max_cycles = MAX(c->max_cycles, cycles);
+    c->n++;
+}
+
+static void bench_timer_expiry(struct k_timer *timer)
+{
+    post_one(&costs[BENCH_PRODUCERS]);
+}
+
+static K_TIMER_DEFINE(bench_timer, bench_timer_expiry, NULL);
+
+static void producer_code(void *argA, void *argB, void *argC)
+{
+    struct post_cost *c = argA;
+    uint32_t burst = (uint32_t)(uintptr_t)argB;
+
+    for (int b = 0; b < BENCH_BURSTS; b++) {
+        for (uint32_t i = 0; i < burst; i++) {
+            post_one(c);
+        }
+        k_msleep(BURST_GAP_MS);
+    }
+}
+
+/* Wait until every accepted update has been applied or coalesced */
+static void bench_drain(struct pwm_cmd_stats *s)
+{
+    int64_t end = k_uptime_get() + DRAIN_TIMEOUT_MS;
+
+    do {
+        k_msleep(1);
+        pwm_cmd_stats_get(s);
+    } while (s->applied + s->coalesced != s->posted && k_uptime_get() < end);
+}
+
+static void bench_one(uint32_t burst)
+{
+    struct pwm_cmd_stats s0, s1;
+    uint64_t sum = 0, max = 0;
+    uint32_t n = 0, posted;
+    int64_t t0;
+
+    bench_drain(&s0);
+    for (int i = 0; i <= BENCH_PRODUCERS; i++) {
+        costs[i] = (struct post_cost){ .seed = 1234 + i };
+    }
+
+    t0 = k_uptime_get();
+    k_timer_start(&bench_timer, K_USEC(TIMER_US), K_USEC(TIMER_US));
+    for (int i = 0; i < BENCH_PRODUCERS; i++) {
+        k_thread_create(&producer_threads[i], producer_stacks[i],
+                        K_THREAD_STACK_SIZEOF(producer_stacks[i]), producer_code,
+                        &costs[i], (void *)(uintptr_t)burst, NULL, PRODUCER_PRIO, 0,
+                        K_NO_WAIT);
+    }
+    for (int i = 0; i < BENCH_PRODUCERS; i++) {
+        k_thread_join(&producer_threads[i], K_FOREVER);
+    }
+    k_timer_stop(&bench_timer);
+    bench_drain(&s1);
+
+    for (int i = 0; i <= BENCH_PRODUCERS; i++) {
+        sum += costs[i].sum_cycles;
+        max = MAX(max, costs[i].max_cycles);
+        n += costs[i].n;
+    }
+    posted = s1.posted - s0.posted;
+
+    printk("pwm cmd bench burst %3u: %5u posted, %4u refused, %5u coalesced, "
+           "%4u applied in %4u frames (%u%% calls saved), post %llu ns avg %llu max, %lld ms\n\r",
+           burst, posted, s1.overflows - s0.overflows, s1.coalesced - s0.coalesced,
+           s1.applied - s0.applied, s1.frames - s0.frames,
+           posted ? 100 - (100 * (s1.frames - s0.frames) + posted / 2) / posted : 0,
+           n ? timing_cycles_to_ns(sum / n) : 0, timing_cycles_to_ns(max),
+           k_uptime_get() - t0);
+}
+
+static void pwm_cmd_bench_thread_code(void *argA, void *argB, void *argC)
+{
+    struct pwm_out_timebase tb;
+    int duty[PWM_OUT_CHANNELS];
+
+    for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+        duty[ch] = pwm_out_get_duty(bench_pins[ch]);
+    }
+    pwm_out_get_timebase(&tb);
+    printk("PWM command queue bench (%u Hz PWM, queue %u, %u bursts x %u threads, "
+           "timer every %u us):\n\r", pwm_out_timebase_hz(&tb),
+           CONFIG_APP_PWM_CMD_QUEUE_SIZE, BENCH_BURSTS, BENCH_PRODUCERS, TIMER_US);
+
+    timing_init();
+    timing_start();
+
+    for (uint32_t burst = 1; burst <= 4 * CONFIG_APP_PWM_CMD_QUEUE_SIZE; burst *= 4) {
+        bench_one(burst);
+    }
+
+    timing_stop();
+
+    /* Back to the levels the manual control last set and displayed */
+    for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+        if (duty[ch] >= 0) {
+            (void)pwm_cmd_post(bench_pins[ch], (uint16_t)duty[ch]);
+        }
+    }
+}
+
+K_THREAD_DEFINE(pwm_cmd_bench_thread, BENCH_STACK_SIZE, pwm_cmd_bench_thread_code,
+                NULL, NULL, NULL, BENCH_PRIO, 0, BENCH_START_MS);
@@ -0,0 +1,584 @@
+/*
+ * PWM output abstraction
+ *
+ * On the nRF52840 PWM0 is driven directly through nrfx in individual load
+ * mode: each sequence entry holds the compare values of all four channels
+ * and is fetched by EasyDMA in one go at the start of a PWM period.
+ * A new channel set is therefore applied atomically at a period boundary.
+ * When a sequence ends the peripheral keeps generating the last loaded
+ * values, so a one-entry (or one-fade) playback is all an update costs.
+ * Fade sequences are generated by curve_fill(), one channel at a time.
+ *
+ * PRESCALER and COUNTERTOP are not double-buffered, so a timebase change
+ * goes through the STOP task, which takes effect at the end of the
+ * current period. The STOPPED interrupt then programs the new timebase and
+ * restarts playback with the rescaled compare values; between the two the
+ * outputs only hold their idle (LED off) level for the ISR latency.
+ *
+ * With APP_POWER, a channel set where every channel is fully off or fully
+ * on (0% / 100%) parks the peripheral: the pins are driven statically
+ * through their GPIO OUT levels, the PWM is stopped at a period boundary
+ * and disabled, and it no longer holds the HF clock. The next set with an
+ * intermediate duty-cycle re-enables it. A cross-fade always plays on the
+ * running PWM, even when it ends at the extremes.
+ *
+ * Pulse widths are kept in counter counts of the current timebase.
+ * On other boards (native_posix) updates are only traced.
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <devicetree.h>
+#include <errno.h>
+#include <string.h>
+
+#include "pwm_out.h"
+#include "sim.h"
+#include "hot.h"
+#include "power.h"
+#include "curve.h"
+
+#define PWM0_NID DT_NODELABEL(pwm0)
+
+#define PWM_OUT_TOP_MIN 3
+
+/* LED pins, one per PWM channel */
+static const uint32_t pwm_out_pins[PWM_OUT_CHANNELS] = {
+    DT_GPIO_PIN(DT_NODELABEL(led0), gpios),
+    DT_GPIO_PIN(DT_NODELABEL(led1), gpios),
+    DT_GPIO_PIN(DT_NODELABEL(led2), gpios),
+    DT_GPIO_PIN(DT_NODELABEL(led3), gpios),
+};
+
+static uint16_t pulse_cur[PWM_OUT_CHANNELS];    /* Current pulse widths (counts) */
+static struct pwm_out_timebase tb_cur;          /* Current timebase */
+static K_MUTEX_DEFINE(pwm_out_lock);
+
+static inline uint32_t tb_clock_hz(const struct pwm_out_timebase *tb)
+{
+    return PWM_OUT_BASE_HZ >> tb->prescaler;
+}
+
+static uint16_t us_to_counts(uint32_t us)
+{
+    uint64_t counts = ((uint64_t)us * tb_clock_hz(&tb_cur)) / USEC_PER_SEC;
+
+    return (uint16_t)MIN(counts, (uint64_t)tb_cur.top);
+}
+
+static uint32_t counts_to_us(uint32_t counts, const struct pwm_out_timebase *tb)
+{
+    return (uint32_t)(((uint64_t)counts * USEC_PER_SEC) / tb_clock_hz(tb));
+}
+
+#if defined(CONFIG_NRFX_PWM0)
+#include <nrfx_pwm.h>
+#include <hal/nrf_gpio.h>
+
+/* The DK LEDs are active low: a compare value without the polarity bit
+ * drives the pin low (LED on) for the first "value" counts of the period */
+#define PWM_OUT_VALUE(counts) ((uint16_t)(counts))
+
+static const nrfx_pwm_t pwm0 = NRFX_PWM_INSTANCE(0);
+
+/* Sequence buffers. EasyDMA reads them, so they must live in RAM */
+static nrf_pwm_values_individual_t frame_buf;
+static nrf_pwm_values_individual_t fade_buf[CONFIG_APP_PWM_FADE_MAX_STEPS];
+
+/* Given when the last playback has been fully loaded by EasyDMA */
+static K_SEM_DEFINE(pwm_loaded, 1, 1);
+
+/* Timebase to program when the STOPPED event arrives */
+static struct pwm_out_timebase tb_pending;
+static volatile bool tb_switch;
+
+/* Given by the STOPPED event when the PWM is stopped to be parked */
+static K_SEM_DEFINE(pwm_stopped, 0, 1);
+
+/* PWM disabled, pins held at static levels */
+static bool parked;
+
+static APP_HOT void pwm_out_play(nrf_pwm_values_individual_t *values, uint16_t entries,
+                                 uint16_t periods_per_entry)
+{
+    nrf_pwm_sequence_t seq = {
+        .values.p_individual = values,
+        .length = entries * PWM_OUT_CHANNELS,
+        .repeats = periods_per_entry - 1,
+        .end_delay = 0,
+    };
+
+    nrfx_pwm_simple_playback(&pwm0, &seq, 1,
+                             NRFX_PWM_FLAG_SIGNAL_END_SEQ0 | NRFX_PWM_FLAG_SIGNAL_END_SEQ1);
+}
+
+static void pwm_out_configure(const struct pwm_out_timebase *tb)
+{
+    nrf_pwm_configure(pwm0.p_registers, (nrf_pwm_clk_t)tb->prescaler, NRF_PWM_MODE_UP,
+                      tb->top);
+}
+
+static APP_HOT void pwm_out_handler(nrfx_pwm_evt_type_t event_type)
+{
+    if (event_type == NRFX_PWM_EVT_END_SEQ0 || event_type == NRFX_PWM_EVT_END_SEQ1) {
+        k_sem_give(&pwm_loaded);
+    } else if (event_type == NRFX_PWM_EVT_STOPPED && tb_switch) {
+        /* The last period of the old timebase has completed */
+        tb_switch = false;
+        pwm_out_configure(&tb_pending);
+        pwm_out_play(&frame_buf, 1, 1);
+    } else if (event_type == NRFX_PWM_EVT_STOPPED) {
+        k_sem_give(&pwm_stopped);
+    }
+}
+
+/* True if every channel is fully off or fully on with counter top "top" */
+static APP_HOT bool pwm_out_is_static(const uint16_t counts[], uint16_t top)
+{
+    for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+        if (counts[ch] != 0 && counts[ch] < top) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Drive the pins at the static levels of "counts" and park the PWM.
+ * Called with pwm_loaded taken, i.e. no playback is still being loaded */
+static void pwm_out_park(const uint16_t counts[], uint16_t top)
+{
+    /* Active-low LEDs: the GPIO level takes over once the PWM is disabled */
+    for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+        nrf_gpio_pin_write(pwm_out_pins[ch], (counts[ch] >= top) ? 0 : 1);
+    }
+    if (parked) {
+        return;
+    }
+
+    if (!nrfx_pwm_is_stopped(&pwm0)) {
+        /* Ends the current period, so the last pulse is not cut short */
+        k_sem_reset(&pwm_stopped);
+        nrfx_pwm_stop(&pwm0, false);
+        k_sem_take(&pwm_stopped, K_FOREVER);
+    }
+    nrf_pwm_disable(pwm0.p_registers);
+    parked = true;
+    power_hf_put(POWER_HF_PWM);
+}
+
+static APP_HOT void pwm_out_unpark(void)
+{
+    if (parked) {
+        power_hf_get(POWER_HF_PWM);
+        nrf_pwm_enable(pwm0.p_registers);
+        parked = false;
+    }
+}
+
+static APP_HOT void pwm_out_fill(nrf_pwm_values_individual_t *v, const uint16_t counts[])
+{
+    v->channel_0 = PWM_OUT_VALUE(counts[0]);
+    v->channel_1 = PWM_OUT_VALUE(counts[1]);
+    v->channel_2 = PWM_OUT_VALUE(counts[2]);
+    v->channel_3 = PWM_OUT_VALUE(counts[3]);
+}
+
+static int pwm_out_hw_init(const struct pwm_out_timebase *tb)
+{
+    nrfx_pwm_config_t config = {
+        .output_pins = {
+            pwm_out_pins[0] | NRFX_PWM_PIN_INVERTED,
+            pwm_out_pins[1] | NRFX_PWM_PIN_INVERTED,
+            pwm_out_pins[2] | NRFX_PWM_PIN_INVERTED,
+            pwm_out_pins[3] | NRFX_PWM_PIN_INVERTED,
+        },
+        .irq_priority = DT_IRQ(PWM0_NID, priority),
+        .base_clock = (nrf_pwm_clk_t)tb->prescaler,
+        .count_mode = NRF_PWM_MODE_UP,
+        .top_value = tb->top,
+        .load_mode = NRF_PWM_LOAD_INDIVIDUAL,
+        .step_mode = NRF_PWM_STEP_AUTO,
+    };
+
+    IRQ_CONNECT(DT_IRQN(PWM0_NID), DT_IRQ(PWM0_NID, priority),
+                nrfx_isr, nrfx_pwm_0_irq_handler, 0);
+
+    if (nrfx_pwm_init(&pwm0, &config, pwm_out_handler) != NRFX_SUCCESS) {
+        return -EBUSY;
+    }
+
+    /* All channels start at 0%, which is a static set */
+    if (IS_ENABLED(CONFIG_APP_POWER)) {
+        const uint16_t off[PWM_OUT_CHANNELS] = { 0 };
+
+        power_hf_get(POWER_HF_PWM);
+        k_sem_take(&pwm_loaded, K_FOREVER);
+        pwm_out_park(off, tb->top);
+        k_sem_give(&pwm_loaded);
+    }
+
+    return 0;
+}
+
+static void pwm_out_hw_timebase(const struct pwm_out_timebase *tb, const uint16_t counts[])
+{
+    k_sem_take(&pwm_loaded, K_FOREVER);
+    pwm_out_fill(&frame_buf, counts);
+
+    if (IS_ENABLED(CONFIG_APP_POWER) && pwm_out_is_static(counts, tb->top)) {
+        pwm_out_park(counts, tb->top);
+        pwm_out_configure(tb);
+        k_sem_give(&pwm_loaded);
+        return;
+    }
+    pwm_out_unpark();
+
+    if (nrfx_pwm_is_stopped(&pwm0)) {
+        pwm_out_configure(tb);
+        pwm_out_play(&frame_buf, 1, 1);
+        return;
+    }
+
+    /* Finish the current period, then restart from the STOPPED event */
+    tb_pending = *tb;
+    tb_switch = true;
+    nrfx_pwm_stop(&pwm0, false);
+}
+
+static APP_HOT void pwm_out_hw_set_all(const uint16_t counts[])
+{
+    k_sem_take(&pwm_loaded, K_FOREVER);
+
+    if (IS_ENABLED(CONFIG_APP_POWER) && pwm_out_is_static(counts, tb_cur.top)) {
+        pwm_out_park(counts, tb_cur.top);
+        k_sem_give(&pwm_loaded);
+        return;
+    }
+    pwm_out_unpark();
+
+    pwm_out_fill(&frame_buf, counts);
+    pwm_out_play(&frame_buf, 1, 1);
+}
+
+static int pwm_out_hw_crossfade(const uint16_t from[], const uint16_t to[],
+                                uint16_t steps, uint16_t periods_per_step,
+                                enum curve_shape shape)
+{
+    k_sem_take(&pwm_loaded, K_FOREVER);
+    pwm_out_unpark();
+
+    /* Each channel is one column of the sequence; PWM_OUT_VALUE() being
+     * the identity, the curve is written as compare values directly */
+    for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+        curve_fill((uint16_t *)fade_buf + ch, steps, PWM_OUT_CHANNELS, from[ch], to[ch], shape);
+    }
+    pwm_out_play(fade_buf, steps, periods_per_step);
+
+    return 0;
+}
+
+static void pwm_out_hw_sync(void)
+{
+    k_sem_take(&pwm_loaded, K_FOREVER);
+    k_sem_give(&pwm_loaded);
+}
+
+#else /* !CONFIG_NRFX_PWM0 */
+
+static int pwm_out_hw_init(const struct pwm_out_timebase *tb)
+{
+    return 0;
+}
+
+static void pwm_out_hw_timebase(const struct pwm_out_timebase *tb, const uint16_t counts[])
+{
+}
+
+static void pwm_out_hw_set_all(const uint16_t counts[])
+{
+}
+
+static int pwm_out_hw_crossfade(const uint16_t from[], const uint16_t to[],
+                                uint16_t steps, uint16_t periods_per_step,
+                                enum curve_shape shape)
+{
+    return 0;
+}
+
+/* No load event: pace updates at one per period, as the PWM would */
+static void pwm_out_hw_sync(void)
+{
+    struct pwm_out_timebase tb;
+
+    pwm_out_get_timebase(&tb);
+    k_usleep((int32_t)counts_to_us(tb.top, &tb));
+}
+
+#endif /* CONFIG_NRFX_PWM0 */
+
+/* Record changed channels; all of them if the timebase changes */
+static void pwm_out_trace(const struct pwm_out_timebase *tb, const uint16_t counts[])
+{
+    if (IS_ENABLED(CONFIG_APP_SIM)) {
+        bool all = (tb->prescaler != tb_cur.prescaler || tb->top != tb_cur.top);
+
+        for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+            if (all || counts[ch] != pulse_cur[ch]) {
+                sim_record_pwm(pwm_out_pins[ch], counts_to_us(tb->top, tb),
+                               counts_to_us(counts[ch], tb));
+            }
+        }
+    }
+}
+
+static APP_HOT int pin_to_channel(uint32_t pin)
+{
+    for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+        if (pwm_out_pins[ch] == pin) {
+            return ch;
+        }
+    }
+
+    return -EINVAL;
+}
+
+/* Called with pwm_out_lock held */
+static void set_timebase_locked(const struct pwm_out_timebase *tb)
+{
+    uint16_t counts[PWM_OUT_CHANNELS];
+
+    if (tb->prescaler == tb_cur.prescaler && tb->top == tb_cur.top) {
+        return;
+    }
+
+    /* Keep the duty-cycles */
+    for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+        counts[ch] = (uint16_t)(((uint32_t)pulse_cur[ch] * tb->top) / tb_cur.top);
+    }
+    pwm_out_trace(tb, counts);
+    pwm_out_hw_timebase(tb, counts);
+    tb_cur = *tb;
+    memcpy(pulse_cur, counts, sizeof(pulse_cur));
+}
+
+/* Called with pwm_out_lock held */
+static APP_HOT void set_all_locked(const uint16_t counts[])
+{
+    pwm_out_trace(&tb_cur, counts);
+    pwm_out_hw_set_all(counts);
+    memcpy(pulse_cur, counts, sizeof(pulse_cur));
+}
+
+int pwm_out_timebase_for(uint32_t freq_hz, struct pwm_out_timebase *tb)
+{
+    if (freq_hz == 0) {
+        return -EINVAL;
+    }
+
+    /* The smallest prescaler gives the largest top, i.e. the finest resolution */
+    for (uint8_t prescaler = 0; prescaler <= 7; prescaler++) {
+        uint32_t clk = PWM_OUT_BASE_HZ >> prescaler;
+        uint32_t top = (clk + freq_hz / 2) / freq_hz;
+
+        if (top < PWM_OUT_TOP_MIN) {
+            return -EINVAL;
+        }
+        if (top <= PWM_OUT_TOP_MAX) {
+            tb->prescaler = prescaler;
+            tb->top = (uint16_t)top;
+            return 0;
+        }
+    }
+
+    return -EINVAL;
+}
+
+uint32_t pwm_out_timebase_hz(const struct pwm_out_timebase *tb)
+{
+    return tb_clock_hz(tb) / tb->top;
+}
+
+int pwm_out_init(void)
+{
+    struct pwm_out_timebase tb;
+    int ret;
+
+    ret = pwm_out_timebase_for(CONFIG_APP_PWM_FREQ_HZ, &tb);
+    if (ret == 0) {
+        tb_cur = tb;
+        ret = pwm_out_hw_init(&tb);
+    }
+
+    return ret;
+}
+
+int pwm_out_set_timebase(const struct pwm_out_timebase *tb)
+{
+    if (tb->prescaler > 7 || tb->top < PWM_OUT_TOP_MIN || tb->top > PWM_OUT_TOP_MAX) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&pwm_out_lock, K_FOREVER);
+    set_timebase_locked(tb);
+    k_mutex_unlock(&pwm_out_lock);
+
+    return 0;
+}
+
+int pwm_out_set_frequency(uint32_t freq_hz)
+{
+    struct pwm_out_timebase tb;
+    int ret = pwm_out_timebase_for(freq_hz, &tb);
+
+    if (ret == 0) {
+        ret = pwm_out_set_timebase(&tb);
+    }
+
+    return ret;
+}
+
+void pwm_out_get_timebase(struct pwm_out_timebase *tb)
+{
+    k_mutex_lock(&pwm_out_lock, K_FOREVER);
+    *tb = tb_cur;
+    k_mutex_unlock(&pwm_out_lock);
+}
+
+int pwm_out_set(uint32_t pin, uint32_t period_us, uint32_t pulse_us)
+{
+    uint16_t counts[PWM_OUT_CHANNELS];
+    struct pwm_out_timebase tb;
+    int ch = pin_to_channel(pin);
+
+    if (ch < 0 || period_us == 0 || pulse_us > period_us) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&pwm_out_lock, K_FOREVER);
+    if (period_us != counts_to_us(tb_cur.top, &tb_cur)) {
+        if (pwm_out_timebase_for(USEC_PER_SEC / period_us, &tb) != 0) {
+            k_mutex_unlock(&pwm_out_lock);
+            return -EINVAL;
+        }
+        set_timebase_locked(&tb);
+    }
+    memcpy(counts, pulse_cur, sizeof(counts));
+    counts[ch] = us_to_counts(pulse_us);
+    set_all_locked(counts);
+    k_mutex_unlock(&pwm_out_lock);
+
+    return 0;
+}
+
+APP_HOT int pwm_out_set_duty(uint32_t pin, uint16_t permille)
+{
+    uint16_t counts[PWM_OUT_CHANNELS];
+    int ch = pin_to_channel(pin);
+
+    if (ch < 0 || permille > 1000) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&pwm_out_lock, K_FOREVER);
+    memcpy(counts, pulse_cur, sizeof(counts));
+    counts[ch] = (uint16_t)(((uint32_t)tb_cur.top * permille) / 1000);
+    set_all_locked(counts);
+    k_mutex_unlock(&pwm_out_lock);
+
+    return 0;
+}
+
+int pwm_out_get_duty(uint32_t pin)
+{
+    int ch = pin_to_channel(pin);
+    uint32_t permille;
+
+    if (ch < 0) {
+        return -EINVAL;
+    }
+
+    /* Rounded up: pwm_out_set_duty() rounds down, so the value read back
+     * gives the same pulse width */
+    k_mutex_lock(&pwm_out_lock, K_FOREVER);
+    permille = DIV_ROUND_UP((uint32_t)pulse_cur[ch] * 1000, tb_cur.top);
+    k_mutex_unlock(&pwm_out_lock);
+
+    return (int)permille;
+}
+
+int pwm_out_set_duties(const uint16_t permille[PWM_OUT_CHANNELS], uint32_t mask)
+{
+    uint16_t counts[PWM_OUT_CHANNELS];
+
+    for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+        if ((mask & BIT(ch)) && permille[ch] > 1000) {
+            return -EINVAL;
+        }
+    }
+
+    k_mutex_lock(&pwm_out_lock, K_FOREVER);
+    memcpy(counts, pulse_cur, sizeof(counts));
+    for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+        if (mask & BIT(ch)) {
+            counts[ch] = (uint16_t)(((uint32_t)tb_cur.top * permille[ch]) / 1000);
+        }
+    }
+    set_all_locked(counts);
+    k_mutex_unlock(&pwm_out_lock);
+
+    return 0;
+}
+
+int pwm_out_channel(uint32_t pin)
+{
+    return pin_to_channel(pin);
+}
+
+void pwm_out_sync(void)
+{
+    pwm_out_hw_sync();
+}
+
+int pwm_out_set_all(const uint16_t pulse_us[PWM_OUT_CHANNELS])
+{
+    uint16_t counts[PWM_OUT_CHANNELS];
+
+    k_mutex_lock(&pwm_out_lock, K_FOREVER);
+    for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+        counts[ch] = us_to_counts(pulse_us[ch]);
+    }
+    set_all_locked(counts);
+    k_mutex_unlock(&pwm_out_lock);
+
+    return 0;
+}
+
+int pwm_out_crossfade(const uint16_t pulse_us[PWM_OUT_CHANNELS], uint16_t steps,
+                      uint16_t periods_per_step)
+{
+    return pwm_out_crossfade_curve(pulse_us, steps, periods_per_step, CURVE_LINEAR);
+}
+
+int pwm_out_crossfade_curve(const uint16_t pulse_us[PWM_OUT_CHANNELS], uint16_t steps,
+                            uint16_t periods_per_step, enum curve_shape shape)
+{
+    uint16_t counts[PWM_OUT_CHANNELS];
+    int ret;
+
+    if (steps == 0 || steps > CONFIG_APP_PWM_FADE_MAX_STEPS || periods_per_step == 0 ||
+        shape >= CURVE_SHAPES) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&pwm_out_lock, K_FOREVER);
+    for (int ch = 0; ch < PWM_OUT_CHANNELS; ch++) {
+        counts[ch] = us_to_counts(pulse_us[ch]);
+    }
+    pwm_out_trace(&tb_cur, counts);
+    ret = pwm_out_hw_crossfade(pulse_cur, counts, steps, periods_per_step, shape);
+    memcpy(pulse_cur, counts, sizeof(pulse_cur));
+    k_mutex_unlock(&pwm_out_lock);
+
+    return ret;
+}
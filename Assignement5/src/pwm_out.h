@@ -0,0 +1,96 @@
+/*
+ * PWM output abstraction
+ *
+ * Drives the four DK LEDs from the four channels of one PWM instance.
+ * All channels are updated together from a single DMA sequence, so a new
+ * set of duty-cycles always takes effect at a PWM period boundary and no
+ * frame ever mixes old and new values.
+ * The PWM frequency and counter resolution (timebase) can be changed at
+ * runtime; duty-cycles are preserved and the switch happens between two
+ * complete periods.
+ * On boards without the nRF PWM (e.g. native_posix) updates are only traced.
+ */
+
+#ifndef PWM_OUT_H
+#define PWM_OUT_H
+
+#include <zephyr/types.h>
+
+#include "curve.h"
+
+/* Number of channels driven by one PWM instance */
+#define PWM_OUT_CHANNELS 4
+
+/* PWM base clock before the prescaler */
+#define PWM_OUT_BASE_HZ 16000000
+
+/* Largest counter top value (15-bit COUNTERTOP) */
+#define PWM_OUT_TOP_MAX 32767
+
+/* Counter timebase: the counter runs at PWM_OUT_BASE_HZ >> prescaler and
+ * wraps after "top" counts, which is also the duty-cycle resolution */
+struct pwm_out_timebase {
+    uint8_t prescaler;      /* 0..7 */
+    uint16_t top;           /* 3..PWM_OUT_TOP_MAX */
+};
+
+/* Bind to the PWM peripheral and start at CONFIG_APP_PWM_FREQ_HZ.
+ * Returns 0 on success, negative errno otherwise */
+int pwm_out_init(void);
+
+/* Set period and pulse width (both in us) of the PWM output at "pin".
+ * The other channels keep their current pulse width; a different period
+ * changes the timebase of all channels. */
+int pwm_out_set(uint32_t pin, uint32_t period_us, uint32_t pulse_us);
+
+/* Set the duty-cycle (permille) of the PWM output at "pin" */
+int pwm_out_set_duty(uint32_t pin, uint16_t permille);
+
+/* Duty-cycle (permille) of the PWM output at "pin", or -EINVAL */
+int pwm_out_get_duty(uint32_t pin);
+
+/* Set the duty-cycles (permille) of the channels in "mask" (bit n for
+ * channel n) to permille[n] in a single update; the other channels keep
+ * theirs */
+int pwm_out_set_duties(const uint16_t permille[PWM_OUT_CHANNELS], uint32_t mask);
+
+/* Channel driving "pin", or -EINVAL */
+int pwm_out_channel(uint32_t pin);
+
+/* Wait until the last update has been loaded by the PWM: an update made
+ * after this returns takes effect at least one period after it */
+void pwm_out_sync(void);
+
+/* Atomically set the pulse width (us) of all channels */
+int pwm_out_set_all(const uint16_t pulse_us[PWM_OUT_CHANNELS]);
+
+/* Cross-fade all channels from their current pulse widths to "pulse_us" in
+ * "steps" linear steps, each held for "periods_per_step" PWM periods.
+ * The whole fade is played by DMA; every frame is a consistent channel set. */
+int pwm_out_crossfade(const uint16_t pulse_us[PWM_OUT_CHANNELS], uint16_t steps,
+                      uint16_t periods_per_step);
+
+/* Same, with the steps following "shape" (see curve.h) */
+int pwm_out_crossfade_curve(const uint16_t pulse_us[PWM_OUT_CHANNELS], uint16_t steps,
+                            uint16_t periods_per_step, enum curve_shape shape);
+
+/* Timebase with the finest duty resolution for "freq_hz" (the smallest
+ * prescaler whose top value still fits). Returns 0 or -EINVAL if the
+ * frequency is out of range */
+int pwm_out_timebase_for(uint32_t freq_hz, struct pwm_out_timebase *tb);
+
+/* Frequency (Hz) produced by "tb" */
+uint32_t pwm_out_timebase_hz(const struct pwm_out_timebase *tb);
+
+/* Switch all channels to timebase "tb", keeping their duty-cycles.
+ * The current period completes; the new timebase starts with a full
+ * period, so no shortened (runt) pulse is emitted. */
+int pwm_out_set_timebase(const struct pwm_out_timebase *tb);
+
+/* Shorthand for pwm_out_timebase_for() + pwm_out_set_timebase() */
+int pwm_out_set_frequency(uint32_t freq_hz);
+
+/* Current timebase */
+void pwm_out_get_timebase(struct pwm_out_timebase *tb);
+
+#endif /* PWM_OUT_H */
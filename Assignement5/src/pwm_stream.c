@@ -0,0 +1,195 @@
+/*
+ * Streaming PWM waveform output
+ *
+ * Each sample is one PWM period (common load mode, REFRESH = 0), clocked from
+ * the 16 MHz PWM base clock. Sequence 0 and 1 point at two DMA buffers and
+ * are looped by the LOOPSDONE -> SEQSTART0 short. When one sequence ends
+ * (SEQEND), EasyDMA has fetched all of its values and the other buffer is
+ * playing, so the ISR refills the finished buffer from the ring buffer.
+ * If the ring buffer runs dry the last sample is held and the gap is counted
+ * as an underrun.
+ *
+ * The ring buffer has a single producer (pwm_stream_write) and a single
+ * consumer (the PWM ISR) and needs no lock: each side only writes its own
+ * index.
+ */
+
+#include <zephyr.h>
+#include <devicetree.h>
+#include <sys/atomic.h>
+#include <errno.h>
+#include <nrfx_pwm.h>
+
+#include "pwm_stream.h"
+#include "power.h"
+#include "metrics.h"
+
+#define PWM1_NID DT_NODELABEL(pwm1)
+
+#define PWM_STREAM_BASE_HZ  16000000
+#define PWM_STREAM_TOP      (PWM_STREAM_BASE_HZ / CONFIG_APP_PWM_STREAM_RATE_HZ)
+#define PWM_STREAM_CHUNK    CONFIG_APP_PWM_STREAM_CHUNK
+#define RING_SIZE           CONFIG_APP_PWM_STREAM_RING_SIZE
+#define RING_MASK           (RING_SIZE - 1)
+
+BUILD_ASSERT((RING_SIZE & RING_MASK) == 0, "Ring size must be a power of two");
+BUILD_ASSERT(PWM_STREAM_TOP >= 3 && PWM_STREAM_TOP <= 32767,
+             "Sample rate out of PWM COUNTERTOP range");
+
+static const nrfx_pwm_t pwm1 = NRFX_PWM_INSTANCE(1);
+
+/* DMA buffers played alternately by sequence 0 and 1 */
+static uint16_t chunk_buf[2][PWM_STREAM_CHUNK];
+
+/* Sample ring buffer */
+static uint16_t ring[RING_SIZE];
+static atomic_t ring_head;      /* Written by the producer only */
+static atomic_t ring_tail;      /* Written by the ISR only */
+static K_SEM_DEFINE(ring_space, 0, 1);
+
+static uint16_t last_value;     /* Compare value held on underrun */
+static struct pwm_stream_stats stats;
+
+METRIC_COUNTER_DEFINE(pwm_stream_underruns);
+
+static inline uint16_t sample_to_value(uint16_t sample)
+{
+    /* Polarity bit set: the pin is high for the first "value" counts.
+     * Scaled to 0..TOP, so that full scale is high for the whole period */
+    uint32_t value = ((uint32_t)sample * (PWM_STREAM_TOP + 1)) >> 16;
+
+    return (uint16_t)MIN(value, PWM_STREAM_TOP) | 0x8000;
+}
+
+static void chunk_fill(uint16_t *buf)
+{
+    uint32_t tail = atomic_get(&ring_tail);
+    uint32_t avail = atomic_get(&ring_head) - tail;
+    uint32_t n = MIN(avail, (uint32_t)PWM_STREAM_CHUNK);
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        buf[i] = sample_to_value(ring[(tail + i) & RING_MASK]);
+    }
+    if (n > 0) {
+        last_value = buf[n - 1];
+        atomic_set(&ring_tail, tail + n);
+        k_sem_give(&ring_space);
+    }
+    if (n < PWM_STREAM_CHUNK) {
+        for (; i < PWM_STREAM_CHUNK; i++) {
+            buf[i] = last_value;
+        }
+        stats.underruns++;
+        metric_inc(METRIC(pwm_stream_underruns));
+        stats.underrun_samples += PWM_STREAM_CHUNK - n;
+    }
+    stats.chunks++;
+}
+
+static void pwm_stream_handler(nrfx_pwm_evt_type_t event_type)
+{
+    if (event_type == NRFX_PWM_EVT_END_SEQ0) {
+        chunk_fill(chunk_buf[0]);
+    } else if (event_type == NRFX_PWM_EVT_END_SEQ1) {
+        chunk_fill(chunk_buf[1]);
+    }
+}
+
+int pwm_stream_init(void)
+{
+    nrfx_pwm_config_t config = {
+        .output_pins = {
+            CONFIG_APP_PWM_STREAM_PIN,
+            NRFX_PWM_PIN_NOT_USED,
+            NRFX_PWM_PIN_NOT_USED,
+            NRFX_PWM_PIN_NOT_USED,
+        },
+        .irq_priority = DT_IRQ(PWM1_NID, priority),
+        .base_clock = NRF_PWM_CLK_16MHz,
+        .count_mode = NRF_PWM_MODE_UP,
+        .top_value = PWM_STREAM_TOP,
+        .load_mode = NRF_PWM_LOAD_COMMON,
+        .step_mode = NRF_PWM_STEP_AUTO,
+    };
+
+    IRQ_CONNECT(DT_IRQN(PWM1_NID), DT_IRQ(PWM1_NID, priority),
+                nrfx_isr, nrfx_pwm_1_irq_handler, 0);
+
+    if (nrfx_pwm_init(&pwm1, &config, pwm_stream_handler) != NRFX_SUCCESS) {
+        return -EBUSY;
+    }
+    last_value = sample_to_value(0);
+
+    return 0;
+}
+
+int pwm_stream_start(void)
+{
+    nrf_pwm_sequence_t seq0 = {
+        .values.p_common = chunk_buf[0],
+        .length = PWM_STREAM_CHUNK,
+        .repeats = 0,
+        .end_delay = 0,
+    };
+    nrf_pwm_sequence_t seq1 = seq0;
+
+    seq1.values.p_common = chunk_buf[1];
+
+    chunk_fill(chunk_buf[0]);
+    chunk_fill(chunk_buf[1]);
+
+    if (IS_ENABLED(CONFIG_APP_POWER)) {
+        power_hf_get(POWER_HF_PWM_STREAM);
+    }
+    nrfx_pwm_complex_playback(&pwm1, &seq0, &seq1, 1,
+                              NRFX_PWM_FLAG_LOOP |
+                              NRFX_PWM_FLAG_SIGNAL_END_SEQ0 |
+                              NRFX_PWM_FLAG_SIGNAL_END_SEQ1);
+
+    return 0;
+}
+
+void pwm_stream_stop(void)
+{
+    nrfx_pwm_stop(&pwm1, true);
+
+    if (IS_ENABLED(CONFIG_APP_POWER)) {
+        power_hf_put(POWER_HF_PWM_STREAM);
+    }
+}
+
+size_t pwm_stream_write(const uint16_t *samples, size_t count, k_timeout_t timeout)
+{
+    size_t done = 0;
+
+    while (done < count) {
+        uint32_t head = atomic_get(&ring_head);
+        uint32_t space = RING_SIZE - (head - atomic_get(&ring_tail));
+        uint32_t n = MIN(space, count - done);
+
+        if (n == 0) {
+            /* Woken by the ISR each time it drains a chunk */
+            if (k_sem_take(&ring_space, timeout) != 0) {
+                break;
+            }
+            continue;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            ring[(head + i) & RING_MASK] = samples[done + i];
+        }
+        /* Publish the samples only after they are in the ring */
+        atomic_set(&ring_head, head + n);
+        done += n;
+    }
+
+    return done;
+}
+
+void pwm_stream_stats_get(struct pwm_stream_stats *out)
+{
+    unsigned int key = irq_lock();
+
+    *out = stats;
+    irq_unlock(key);
+}
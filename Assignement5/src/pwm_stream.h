@@ -0,0 +1,42 @@
+/*
+ * Streaming PWM waveform output
+ *
+ * Plays an arbitrary sample stream (envelopes, low-rate audio) on one PWM
+ * output at a fixed sample rate. A producer writes samples into a ring
+ * buffer; the PWM peripheral consumes them by EasyDMA from two alternating
+ * sequence buffers, so output timing is set by the PWM clock alone and does
+ * not depend on thread scheduling.
+ */
+
+#ifndef PWM_STREAM_H
+#define PWM_STREAM_H
+
+#include <zephyr.h>
+
+/* Full scale sample value (100% duty-cycle) */
+#define PWM_STREAM_SAMPLE_MAX UINT16_MAX
+
+struct pwm_stream_stats {
+    uint32_t chunks;            /* DMA buffers played */
+    uint32_t underruns;         /* Buffers that could not be filled completely */
+    uint32_t underrun_samples;  /* Sample periods padded with the last sample */
+};
+
+/* Configure the PWM instance and output pin. Returns 0 or negative errno */
+int pwm_stream_init(void);
+
+/* Start playback. Samples already written are played first */
+int pwm_stream_start(void);
+
+/* Stop playback at the end of the current PWM period */
+void pwm_stream_stop(void);
+
+/* Queue up to "count" samples (0..PWM_STREAM_SAMPLE_MAX), waiting up to
+ * "timeout" for ring buffer space. Returns the number of samples queued.
+ * Must be called from a single producer thread. */
+size_t pwm_stream_write(const uint16_t *samples, size_t count, k_timeout_t timeout);
+
+/* Copy the streaming statistics */
+void pwm_stream_stats_get(struct pwm_stream_stats *stats);
+
+#endif /* PWM_STREAM_H */
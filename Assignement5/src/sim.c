@@ -0,0 +1,143 @@
+/*
+ * Accelerated-time simulation harness (native_posix only)
+ *
+ * native_posix runs the kernel on simulated time, so with
+ * CONFIG_NATIVE_POSIX_SLOWDOWN_TO_REAL_TIME=n a simulated day only takes as
+ * long as the host needs to execute it. Since the input trace is replayed at
+ * fixed simulated instants and only simulated time is written to the output
+ * trace, two runs with the same input produce identical output files.
+ *
+ * native_posix builds against the host C library, so plain stdio is used for
+ * the trace files.
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/gpio.h>
+#include <drivers/gpio/gpio_emul.h>
+#include <sys/printk.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "soc.h"
+#include "cmdline.h"
+#include "posix_board_if.h"
+#include "posix_trace.h"
+
+#include "sim.h"
+
+#define GPIO0_NID DT_NODELABEL(gpio0)
+
+/* Replay thread */
+#define SIM_STACK_SIZE 1024
+#define SIM_PRIO 0          /* Higher than the application threads */
+#define SIM_LINE_MAX 80
+#define SIM_TRACE_OUT_DEFAULT "sim_out.trace"
+
+static char *trace_in_path;
+static char *trace_out_path = SIM_TRACE_OUT_DEFAULT;
+static uint32_t stop_s = CONFIG_APP_SIM_DEFAULT_STOP_S;
+static FILE *trace_out;
+
+static void sim_add_options(void)
+{
+    static struct args_struct_t sim_options[] = {
+        {
+            .option = "trace-in",
+            .name = "file",
+            .type = 's',
+            .dest = (void *)&trace_in_path,
+            .descript = "Button edge trace to replay, one '<ms> <pin> <level>' per line"
+        },
+        {
+            .option = "trace-out",
+            .name = "file",
+            .type = 's',
+            .dest = (void *)&trace_out_path,
+            .descript = "File to record PWM outputs and clock state to (default "
+                        SIM_TRACE_OUT_DEFAULT ")"
+        },
+        {
+            .option = "sim-stop",
+            .name = "s",
+            .type = 'u',
+            .dest = (void *)&stop_s,
+            .descript = "Simulated run length in seconds"
+        },
+        ARG_TABLE_ENDMARKER
+    };
+
+    native_add_command_line_opts(sim_options);
+}
+NATIVE_TASK(sim_add_options, PRE_BOOT_1, 10);
+
+/* Never stdout: printk output goes there too and would mix with the trace */
+static void sim_open_output(void)
+{
+    trace_out = fopen(trace_out_path, "w");
+    if (trace_out == NULL) {
+        posix_print_error_and_exit("Failed to open %s\n", trace_out_path);
+    }
+}
+NATIVE_TASK(sim_open_output, PRE_BOOT_3, 10);
+
+void sim_record_pwm(uint32_t pin, uint32_t period_us, uint32_t pulse_us)
+{
+    fprintf(trace_out, "%lld pwm %u %u %u\n", k_uptime_get(), pin, period_us, pulse_us);
+}
+
+void sim_record_clock(int horas, int min, int seg)
+{
+    fprintf(trace_out, "%lld clk %02d:%02d:%02d\n", k_uptime_get(), horas, min, seg);
+}
+
+static void sim_replay(const struct device *gpio_dev, FILE *in)
+{
+    char line[SIM_LINE_MAX];
+    long long t_ms;
+    unsigned int pin, level;
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if (sscanf(line, "%lld %u %u", &t_ms, &pin, &level) != 3) {
+            printk("sim: ignoring malformed trace line: %s", line);
+            continue;
+        }
+        if (t_ms >= (long long)stop_s * MSEC_PER_SEC) {
+            break;
+        }
+
+        k_sleep(K_TIMEOUT_ABS_MS(t_ms));
+        gpio_emul_input_set(gpio_dev, (gpio_pin_t)pin, level);
+    }
+}
+
+static void sim_thread_code(void *argA, void *argB, void *argC)
+{
+    const struct device *gpio_dev = device_get_binding(DT_LABEL(GPIO0_NID));
+    FILE *in;
+
+    if (trace_in_path != NULL) {
+        in = fopen(trace_in_path, "r");
+        if (in == NULL) {
+            posix_print_error_and_exit("Failed to open %s\n", trace_in_path);
+        }
+        sim_replay(gpio_dev, in);
+        fclose(in);
+    }
+
+    /* Let the application run until the requested simulated instant */
+    k_sleep(K_TIMEOUT_ABS_MS((int64_t)stop_s * MSEC_PER_SEC));
+
+    fflush(trace_out);
+    if (trace_out != stdout) {
+        fclose(trace_out);
+    }
+    posix_exit(0);
+}
+
+K_THREAD_DEFINE(sim_thread, SIM_STACK_SIZE, sim_thread_code, NULL, NULL, NULL,
+                SIM_PRIO, 0, 0);
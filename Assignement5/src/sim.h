@@ -0,0 +1,24 @@
+/*
+ * Accelerated-time simulation harness (native_posix only)
+ *
+ * Replays a trace of button edges through the GPIO emulator and records
+ * PWM outputs and clock state, timestamped in simulated milliseconds.
+ *
+ * Command line options (zephyr.exe):
+ *   --trace-in=<file>   input edge trace, one "<ms> <pin> <level>" per line
+ *   --trace-out=<file>  output trace (default: sim_out.trace)
+ *   --sim-stop=<s>      simulated run length in seconds
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <zephyr/types.h>
+
+/* Record a PWM update in the output trace */
+void sim_record_pwm(uint32_t pin, uint32_t period_us, uint32_t pulse_us);
+
+/* Record the clock state in the output trace */
+void sim_record_clock(int horas, int min, int seg);
+
+#endif /* SIM_H */
@@ -0,0 +1,386 @@
+/*
+ * Binary telemetry
+ *
+ * Two frame buffers: producers append records to one, under a spinlock,
+ * while the thread sends the other. Records are written raw straight
+ * into the buffer, at an offset that leaves room for the COBS overhead
+ * (one byte per 254), and the frame is COBS encoded in place towards the
+ * start of the buffer: the encoder never writes ahead of what it reads.
+ * The encoded frame is then transmitted from the same buffer, so a record
+ * is written once and never copied.
+ *
+ * When the frame being filled is full and the other one is still being
+ * sent, records are dropped; the next record that fits is preceded by a
+ * TELEM_DROPPED count.
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/uart.h>
+#include <spinlock.h>
+#include <sys/byteorder.h>
+#include <sys/crc.h>
+#include <sys/printk.h>
+#include <string.h>
+
+#include "telem.h"
+#include "metrics.h"
+
+#define FRAME_MAX       CONFIG_APP_TELEM_FRAME_MAX
+#define COBS_OFFSET     (1 + FRAME_MAX / 254)
+#define HDR_SIZE        6
+#define CRC_SIZE        2
+#define VARINT_MAX      5
+#define REC_HDR_MAX     (1 + VARINT_MAX)    /* Type, dt */
+#define DROPPED_MAX     (REC_HDR_MAX + VARINT_MAX)
+
+#define METRIC_VALUES_MAX 64
+
+#define TELEM_STACK_SIZE 1024
+#define TELEM_PRIO      8
+
+struct telem_buf {
+    uint8_t data[COBS_OFFSET + FRAME_MAX + 1];
+    size_t len;             /* Raw frame bytes so far, 0 if empty */
+    uint32_t last_ms;       /* Uptime of the last record */
+    uint32_t last_epoch;    /* Epoch of the last TELEM_CLOCK */
+    uint32_t records;
+    bool has_metrics;       /* metrics_prev holds this frame's snapshot */
+};
+
+static struct telem_buf bufs[2];
+static struct telem_buf *fill = &bufs[0];   /* Being filled */
+static struct telem_buf *sending;           /* Closed, owned by the thread */
+static uint32_t lost;                       /* Dropped since the last report */
+static uint8_t seq;
+static size_t n_values;                     /* Metric values, all metrics */
+static uint32_t metrics_prev[METRIC_VALUES_MAX];
+
+static struct k_spinlock telem_lock;
+static K_SEM_DEFINE(frame_ready, 0, 1);
+static struct telem_stats stats;
+
+static const struct device *uart_dev;
+
+METRIC_COUNTER_DEFINE(telem_dropped);
+
+static inline uint8_t *raw(struct telem_buf *b)
+{
+    return &b->data[COBS_OFFSET];
+}
+
+static size_t put_varint(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+
+    return n;
+}
+
+static inline uint32_t zigzag(int32_t d)
+{
+    return (d >= 0) ? 2 * (uint32_t)d : 2 * (uint32_t)-d - 1;
+}
+
+/* Hand the frame being filled over to the thread. Called with the lock
+ * held. Fails while the previous frame is still being sent */
+static bool close_frame(void)
+{
+    if (sending != NULL) {
+        return false;
+    }
+    if (fill->len == 0) {
+        return true;
+    }
+    sending = fill;
+    fill = (fill == &bufs[0]) ? &bufs[1] : &bufs[0];
+    fill->len = 0;
+    k_sem_give(&frame_ready);
+
+    return true;
+}
+
+/* Start a record of "type" with up to "payload_max" bytes of payload.
+ * Returns where the payload goes, or NULL if the record is dropped.
+ * Called with the lock held; complete with rec_end() */
+static uint8_t *rec_begin(uint8_t type, size_t payload_max)
+{
+    uint32_t now = k_uptime_get_32();
+    size_t need = DROPPED_MAX + REC_HDR_MAX + payload_max + CRC_SIZE;
+    uint8_t *p;
+
+    if (MAX(fill->len, HDR_SIZE) + need > FRAME_MAX) {
+        if (!close_frame() || HDR_SIZE + need > FRAME_MAX) {
+            lost++;
+            stats.dropped++;
+            metric_inc(METRIC(telem_dropped));
+            return NULL;
+        }
+    }
+
+    p = raw(fill);
+    if (fill->len == 0) {
+        p[0] = TELEM_VERSION;
+        p[1] = seq++;
+        sys_put_le32(now, &p[2]);
+        fill->len = HDR_SIZE;
+        fill->last_ms = now;
+        fill->last_epoch = 0;
+        fill->records = 0;
+        fill->has_metrics = false;
+    }
+    p += fill->len;
+
+    if (lost != 0) {
+        *p++ = TELEM_DROPPED;
+        p += put_varint(p, now - fill->last_ms);
+        p += put_varint(p, lost);
+        lost = 0;
+        fill->last_ms = now;
+        fill->records++;
+    }
+    *p++ = type;
+    p += put_varint(p, now - fill->last_ms);
+    fill->last_ms = now;
+
+    return p;
+}
+
+static void rec_end(uint8_t *end)
+{
+    fill->len = end - raw(fill);
+    fill->records++;
+}
+
+void telem_clock(uint32_t epoch)
+{
+    k_spinlock_key_t key = k_spin_lock(&telem_lock);
+    uint8_t *p = rec_begin(TELEM_CLOCK, VARINT_MAX);
+
+    if (p != NULL) {
+        p += put_varint(p, zigzag((int32_t)(epoch - fill->last_epoch)));
+        fill->last_epoch = epoch;
+        rec_end(p);
+    }
+    k_spin_unlock(&telem_lock, key);
+}
+
+void telem_duty(uint8_t pin, uint16_t permille)
+{
+    k_spinlock_key_t key = k_spin_lock(&telem_lock);
+    uint8_t *p = rec_begin(TELEM_DUTY, 1 + VARINT_MAX);
+
+    if (p != NULL) {
+        *p++ = pin;
+        p += put_varint(p, permille);
+        rec_end(p);
+    }
+    k_spin_unlock(&telem_lock, key);
+}
+
+void telem_button(uint8_t button, uint8_t gesture)
+{
+    k_spinlock_key_t key = k_spin_lock(&telem_lock);
+    uint8_t *p = rec_begin(TELEM_BUTTON, 2);
+
+    if (p != NULL) {
+        *p++ = button;
+        *p++ = gesture;
+        rec_end(p);
+    }
+    k_spin_unlock(&telem_lock, key);
+}
+
+static void telem_metrics(void)
+{
+    size_t map_size = (n_values + 7) / 8;
+    k_spinlock_key_t key = k_spin_lock(&telem_lock);
+    uint8_t *p = rec_begin(TELEM_METRICS, 2 + VARINT_MAX + map_size + n_values * VARINT_MAX);
+
+    if (p != NULL) {
+        uint8_t *map;
+        size_t i = 0;
+
+        if (!fill->has_metrics) {
+            memset(metrics_prev, 0, sizeof(metrics_prev));
+            fill->has_metrics = true;
+        }
+        sys_put_le16(metrics_layout(), p);
+        p += 2;
+        p += put_varint(p, n_values);
+        map = p;
+        memset(map, 0, map_size);
+        p += map_size;
+        STRUCT_SECTION_FOREACH(metric, m) {
+            for (int j = 0; j < m->n_values; j++, i++) {
+                uint32_t v = (uint32_t)atomic_get(&m->values[j]);
+
+                if (v != metrics_prev[i]) {
+                    map[i / 8] |= BIT(i % 8);
+                    p += put_varint(p, zigzag((int32_t)(v - metrics_prev[i])));
+                    metrics_prev[i] = v;
+                }
+            }
+        }
+        rec_end(p);
+    }
+    k_spin_unlock(&telem_lock, key);
+}
+
+/* COBS encode "len" bytes at COBS_OFFSET to the start of "buf". Returns
+ * the encoded length */
+static size_t cobs_encode(uint8_t *buf, size_t len)
+{
+    size_t code_pos = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+
+    for (size_t i = COBS_OFFSET; i < COBS_OFFSET + len; i++) {
+        uint8_t b = buf[i];
+
+        if (b != 0) {
+            buf[out++] = b;
+            code++;
+        }
+        if (b == 0 || code == 0xff) {
+            buf[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+        }
+    }
+    buf[code_pos] = code;
+
+    return out;
+}
+
+#if defined(CONFIG_UART_INTERRUPT_DRIVEN)
+static const uint8_t *tx_data;
+static size_t tx_left;
+static K_SEM_DEFINE(tx_done, 0, 1);
+
+static void uart_isr(const struct device *dev, void *user_data)
+{
+    while (uart_irq_update(dev) && uart_irq_tx_ready(dev)) {
+        int n;
+
+        if (tx_left == 0) {
+            uart_irq_tx_disable(dev);
+            k_sem_give(&tx_done);
+            break;
+        }
+        n = uart_fifo_fill(dev, tx_data, tx_left);
+        if (n <= 0) {
+            break;
+        }
+        tx_data += n;
+        tx_left -= n;
+    }
+}
+
+static void tx(const uint8_t *data, size_t len)
+{
+    tx_data = data;
+    tx_left = len;
+    uart_irq_tx_enable(uart_dev);
+    k_sem_take(&tx_done, K_FOREVER);
+}
+#else
+static void tx(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        uart_poll_out(uart_dev, data[i]);
+    }
+}
+#endif /* CONFIG_UART_INTERRUPT_DRIVEN */
+
+static void send(struct telem_buf *b)
+{
+    k_spinlock_key_t key;
+    size_t len = b->len;
+
+    sys_put_le16(crc16_ccitt(0xffff, raw(b), len), &raw(b)[len]);
+    len = cobs_encode(b->data, len + CRC_SIZE);
+    b->data[len++] = 0;
+    tx(b->data, len);
+
+    key = k_spin_lock(&telem_lock);
+    stats.frames++;
+    stats.records += b->records;
+    stats.raw_bytes += b->len + CRC_SIZE;
+    stats.wire_bytes += len;
+    sending = NULL;
+    k_spin_unlock(&telem_lock, key);
+}
+
+void telem_stats_get(struct telem_stats *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&telem_lock);
+
+    *out = stats;
+    k_spin_unlock(&telem_lock, key);
+}
+
+void telem_dump(void)
+{
+    struct telem_stats s;
+
+    telem_stats_get(&s);
+    printk("telem: %u frames, %u records, %u dropped, %u bytes sent "
+           "(%u before framing)\n\r", s.frames, s.records, s.dropped,
+           s.wire_bytes, s.raw_bytes);
+}
+
+static void telem_thread_code(void *argA, void *argB, void *argC)
+{
+    int64_t next_metrics = k_uptime_get();
+    int64_t next_flush = next_metrics + CONFIG_APP_TELEM_FLUSH_MS;
+    bool metrics = CONFIG_APP_TELEM_METRICS_MS > 0;
+
+    uart_dev = device_get_binding(CONFIG_APP_TELEM_UART);
+    if (uart_dev == NULL) {
+        printk("Error: telemetry UART %s not found\n\r", CONFIG_APP_TELEM_UART);
+        return;
+    }
+#if defined(CONFIG_UART_INTERRUPT_DRIVEN)
+    uart_irq_callback_user_data_set(uart_dev, uart_isr, NULL);
+#endif
+
+    STRUCT_SECTION_FOREACH(metric, m) {
+        n_values += m->n_values;
+    }
+    if (metrics && (n_values > METRIC_VALUES_MAX ||
+                    HDR_SIZE + DROPPED_MAX + REC_HDR_MAX + 2 + VARINT_MAX +
+                    (n_values + 7) / 8 + n_values * VARINT_MAX + CRC_SIZE > FRAME_MAX)) {
+        printk("Error: %u metric values do not fit a telemetry frame\n\r",
+               (unsigned int)n_values);
+        metrics = false;
+    }
+
+    while (1) {
+        int64_t now = k_uptime_get();
+
+        if (metrics && now >= next_metrics) {
+            telem_metrics();
+            next_metrics += CONFIG_APP_TELEM_METRICS_MS;
+        }
+        if (now >= next_flush) {
+            k_spinlock_key_t key = k_spin_lock(&telem_lock);
+
+            close_frame();
+            k_spin_unlock(&telem_lock, key);
+            next_flush = now + CONFIG_APP_TELEM_FLUSH_MS;
+        }
+        if (k_sem_take(&frame_ready, K_TIMEOUT_ABS_MS(metrics ? MIN(next_metrics, next_flush)
+                                                              : next_flush)) == 0) {
+            send(sending);
+        }
+    }
+}
+
+K_THREAD_DEFINE(telem_thread, TELEM_STACK_SIZE, telem_thread_code, NULL, NULL, NULL,
+                TELEM_PRIO, 0, 0);
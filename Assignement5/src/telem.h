@@ -0,0 +1,74 @@
+/*
+ * Binary telemetry
+ *
+ * Status records (clock, duty-cycle, buttons, metrics snapshots) are
+ * batched into frames sent on a dedicated UART, as a compact alternative
+ * to the console text. Decode them with scripts/telem_decode.py.
+ * Records are queued from any context; a thread closes the frame when it
+ * is full or every APP_TELEM_FLUSH_MS, and sends it. Clock and metrics
+ * are delta coded within a frame, so the longer the batch, the denser.
+ *
+ * Frame, before framing:
+ *   version  u8       TELEM_VERSION
+ *   seq      u8       frame counter, for loss detection
+ *   base_ms  u32 LE   uptime of the first record
+ *   records  ...
+ *   crc      u16 LE   crc16_ccitt() (seed 0xffff) over all the above
+ * It is COBS encoded, so it holds no zero byte, and followed by one zero
+ * byte as the delimiter.
+ *
+ * Record: type u8, dt varint (ms since the previous record, or base_ms),
+ * then the payload. Varints are unsigned LEB128 (7 bits per byte, low
+ * first, bit 7 set on all but the last byte).
+ *   TELEM_CLOCK    epoch (seconds since 1970) less the epoch of the
+ *                  previous TELEM_CLOCK of the frame (0 for the first),
+ *                  zigzag varint: 2 x d for d >= 0, -2 x d - 1 otherwise
+ *   TELEM_DUTY     pin u8, permille varint
+ *   TELEM_BUTTON   button u8 (1..4), gesture u8 (enum gesture, or
+ *                  TELEM_PRESS without gesture recognition)
+ *   TELEM_METRICS  layout u16 LE, n varint (number of values), a bitmap
+ *                  of n bits (bit i in byte i / 8, LSB first), then for
+ *                  each bit set, in export order (see metrics.h), the
+ *                  value less its value in the previous TELEM_METRICS of
+ *                  the frame (0 for the first), zigzag varint. Unchanged
+ *                  values have their bit clear and take no other space
+ *   TELEM_DROPPED  count varint: records lost before this one
+ */
+
+#ifndef TELEM_H
+#define TELEM_H
+
+#include <zephyr.h>
+
+#define TELEM_VERSION 1
+
+enum telem_type {
+    TELEM_CLOCK = 1,
+    TELEM_DUTY,
+    TELEM_BUTTON,
+    TELEM_METRICS,
+    TELEM_DROPPED,
+};
+
+#define TELEM_PRESS 0xff
+
+struct telem_stats {
+    uint32_t frames;        /* Frames sent */
+    uint32_t records;       /* Records sent */
+    uint32_t dropped;       /* Records lost, both frame buffers being busy */
+    uint32_t raw_bytes;     /* Frame contents, before COBS */
+    uint32_t wire_bytes;    /* Bytes sent, framing included */
+};
+
+/* Records. Safe from any context, including ISRs */
+void telem_clock(uint32_t epoch);
+void telem_duty(uint8_t pin, uint16_t permille);
+void telem_button(uint8_t button, uint8_t gesture);
+
+/* Copy the statistics */
+void telem_stats_get(struct telem_stats *stats);
+
+/* Print the statistics */
+void telem_dump(void);
+
+#endif /* TELEM_H */
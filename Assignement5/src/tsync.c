@@ -0,0 +1,400 @@
+/*
+ * UART time synchronization
+ *
+ * Receive: bytes are fed to one frame parser, from the UART RX interrupt
+ * where the driver supports it, else from a thread polling the UART every
+ * kernel tick (native_posix). The parser stamps the SOF byte and queues
+ * complete frames for the protocol thread.
+ *
+ * Transmit: polled. The SOF byte is written with interrupts locked right
+ * after reading the clock, so its timestamp is the start of transmission;
+ * the master then serializes t3 into the same frame (one-step).
+ *
+ * Slave servo: exchanges whose delay exceeds the smallest delay of the
+ * last TSYNC_WINDOW exchanges by more than APP_TSYNC_JITTER_US were
+ * queued somewhere and are discarded. Each accepted offset feeds a PI
+ * controller: 0.3 x offset per period accumulates into the frequency
+ * estimate, 0.7 x offset is slewed in as phase.
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/uart.h>
+#include <sys/byteorder.h>
+#include <sys/crc.h>
+#include <sys/printk.h>
+#include <stdlib.h>
+
+#include "tsync.h"
+#include "clock.h"
+#include "metrics.h"
+
+#define TSYNC_SOF           0xA5
+#define TSYNC_REQ           1
+#define TSYNC_RESP          2
+#define TSYNC_FRAME_MAX     (1 + 3 + 16 + 1)
+
+#define PERIOD_MS           CONFIG_APP_TSYNC_PERIOD_MS
+#define TSYNC_WINDOW        8       /* Exchanges for the minimum delay */
+#define TSYNC_RESIDUAL      16      /* Locked offsets for the residual */
+#define TSYNC_LOCK_COUNT    4       /* Consecutive offsets to declare lock */
+#define TSYNC_MAX_FREQ_PPB  500000
+
+#define TSYNC_STACK_SIZE    1024
+#define TSYNC_PRIO          4
+
+struct tsync_frame {
+    uint8_t type;
+    uint8_t node;
+    uint8_t seq;
+    uint64_t t2;
+    uint64_t t3;
+    uint64_t rx_ns;         /* Arrival of the SOF byte */
+};
+
+K_MSGQ_DEFINE(tsync_rx_q, sizeof(struct tsync_frame), 4, 8);
+
+static const struct device *uart_dev;
+static uint32_t char_ns;            /* One 10-bit character on the wire */
+
+/* Frame parser */
+static uint8_t rx_buf[TSYNC_FRAME_MAX];
+static uint8_t rx_len;
+static uint8_t rx_need;
+static uint64_t rx_sof_ns;
+
+static struct tsync_stats stats;
+
+METRIC_COUNTER_DEFINE(tsync_exchanges);
+METRIC_COUNTER_DEFINE(tsync_rejected);
+METRIC_COUNTER_DEFINE(tsync_crc_errors);
+
+static void rx_frame(void)
+{
+    struct tsync_frame f = {
+        .type = rx_buf[1],
+        .node = rx_buf[2],
+        .seq = rx_buf[3],
+        .rx_ns = rx_sof_ns,
+    };
+
+    if (crc8_ccitt(0xff, &rx_buf[1], rx_need - 2) != rx_buf[rx_need - 1]) {
+        metric_inc(METRIC(tsync_crc_errors));
+        return;
+    }
+    if (f.type == TSYNC_RESP) {
+        f.t2 = sys_get_le64(&rx_buf[4]);
+        f.t3 = sys_get_le64(&rx_buf[12]);
+    }
+    k_msgq_put(&tsync_rx_q, &f, K_NO_WAIT);
+}
+
+/* "ts": clock time at which "b" started on the wire */
+static void rx_byte(uint8_t b, uint64_t ts)
+{
+    if (rx_len == 0) {
+        if (b == TSYNC_SOF) {
+            rx_buf[rx_len++] = b;
+            rx_sof_ns = ts;
+        }
+        return;
+    }
+
+    rx_buf[rx_len++] = b;
+    if (rx_len == 2) {
+        if (b == TSYNC_REQ) {
+            rx_need = 1 + 3 + 1;
+        } else if (b == TSYNC_RESP) {
+            rx_need = 1 + 3 + 16 + 1;
+        } else {
+            rx_len = 0;
+        }
+        return;
+    }
+    if (rx_len == rx_need) {
+        rx_frame();
+        rx_len = 0;
+    }
+}
+
+#if defined(CONFIG_UART_INTERRUPT_DRIVEN)
+static void uart_isr(const struct device *dev, void *user_data)
+{
+    uint64_t now = clock_now_ns();
+    uint8_t buf[8];
+    int n;
+
+    while (uart_irq_update(dev) && uart_irq_rx_ready(dev)) {
+        n = uart_fifo_read(dev, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        /* The last byte read has just completed */
+        for (int i = 0; i < n; i++) {
+            rx_byte(buf[i], now - (uint64_t)char_ns * (n - i));
+        }
+    }
+}
+
+static int rx_start(void)
+{
+    uart_irq_callback_user_data_set(uart_dev, uart_isr, NULL);
+    uart_irq_rx_enable(uart_dev);
+
+    return 0;
+}
+#else
+K_THREAD_STACK_DEFINE(tsync_rx_stack, TSYNC_STACK_SIZE);
+static struct k_thread tsync_rx_thread;
+
+static void rx_poll(void *argA, void *argB, void *argC)
+{
+    unsigned char c;
+
+    while (1) {
+        while (uart_poll_in(uart_dev, &c) == 0) {
+            rx_byte(c, clock_now_ns() - char_ns);
+        }
+        k_sleep(K_TICKS(1));
+    }
+}
+
+static int rx_start(void)
+{
+    k_thread_create(&tsync_rx_thread, tsync_rx_stack, K_THREAD_STACK_SIZEOF(tsync_rx_stack),
+                    rx_poll, NULL, NULL, NULL, TSYNC_PRIO - 1, 0, K_NO_WAIT);
+    k_thread_name_set(&tsync_rx_thread, "tsync_rx");
+
+    return 0;
+}
+#endif /* CONFIG_UART_INTERRUPT_DRIVEN */
+
+/* Send a frame; "t2" is the RESP payload. Returns the SOF transmit time */
+static uint64_t tx_frame(uint8_t type, uint8_t node, uint8_t seq, uint64_t t2)
+{
+    uint8_t f[TSYNC_FRAME_MAX];
+    size_t len = 0;
+    unsigned int key;
+    uint64_t ts;
+
+    key = irq_lock();
+    ts = clock_now_ns();
+    uart_poll_out(uart_dev, TSYNC_SOF);
+    irq_unlock(key);
+
+    f[len++] = type;
+    f[len++] = node;
+    f[len++] = seq;
+    if (type == TSYNC_RESP) {
+        sys_put_le64(t2, &f[len]);
+        len += 8;
+        sys_put_le64(ts, &f[len]);
+        len += 8;
+    }
+    f[len] = crc8_ccitt(0xff, f, len);
+    len++;
+    for (size_t i = 0; i < len; i++) {
+        uart_poll_out(uart_dev, f[i]);
+    }
+
+    return ts;
+}
+
+#if defined(CONFIG_APP_TSYNC_MASTER)
+
+static void tsync_run(void)
+{
+    struct tsync_frame f;
+
+    printk("tsync: master on %s\n\r", uart_dev->name);
+    while (1) {
+        k_msgq_get(&tsync_rx_q, &f, K_FOREVER);
+        if (f.type == TSYNC_REQ) {
+            tx_frame(TSYNC_RESP, f.node, f.seq, f.rx_ns);
+        }
+    }
+}
+
+#else /* CONFIG_APP_TSYNC_SLAVE */
+
+static int64_t delays[TSYNC_WINDOW];
+static unsigned int n_delays;
+static int64_t residual[TSYNC_RESIDUAL];
+static unsigned int n_residual;
+static unsigned int in_bound;           /* Consecutive offsets within the lock bound */
+static bool acquired;
+static int64_t freq_ppb;
+static int64_t start_ms;
+
+static uint32_t isqrt64(uint64_t v)
+{
+    uint64_t r = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)r;
+}
+
+/* Smallest delay of the last TSYNC_WINDOW exchanges, including "delay" */
+static int64_t min_delay(int64_t delay)
+{
+    int64_t min = delay;
+
+    delays[n_delays++ % TSYNC_WINDOW] = delay;
+    for (unsigned int i = 0; i < MIN(n_delays, TSYNC_WINDOW); i++) {
+        min = MIN(min, delays[i]);
+    }
+
+    return min;
+}
+
+static void residual_add(int64_t offset)
+{
+    uint64_t sq = 0;
+    uint32_t max = 0;
+    unsigned int n;
+
+    residual[n_residual++ % TSYNC_RESIDUAL] = offset;
+    n = MIN(n_residual, TSYNC_RESIDUAL);
+    for (unsigned int i = 0; i < n; i++) {
+        uint32_t a = (uint32_t)MIN(llabs(residual[i]), (int64_t)UINT32_MAX);
+
+        sq += (uint64_t)a * a;
+        max = MAX(max, a);
+    }
+    stats.residual_rms_ns = isqrt64(sq / n);
+    stats.residual_max_ns = max;
+}
+
+static void servo_sample(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4)
+{
+    int64_t offset = ((int64_t)(t1 - t2) + (int64_t)(t4 - t3)) / 2;
+    int64_t delay = (int64_t)(t4 - t1) - (int64_t)(t3 - t2);
+
+    stats.exchanges++;
+    metric_inc(METRIC(tsync_exchanges));
+    if (delay > min_delay(delay) + CONFIG_APP_TSYNC_JITTER_US * NSEC_PER_USEC) {
+        stats.rejected++;
+        metric_inc(METRIC(tsync_rejected));
+        return;
+    }
+    stats.offset_ns = (int32_t)CLAMP(offset, INT32_MIN, INT32_MAX);
+    stats.delay_ns = (uint32_t)CLAMP(delay, 0, UINT32_MAX);
+
+    if (!acquired) {
+        acquired = true;
+        if (llabs(offset) > CONFIG_APP_TSYNC_STEP_MS * NSEC_PER_MSEC) {
+            printk("tsync: step %d ms\n\r", (int32_t)(offset / NSEC_PER_MSEC));
+            clock_step_ns(offset);
+            return;
+        }
+    }
+
+    /* PI: offset x 0.3 per period into the frequency, offset x 0.7 slewed */
+    freq_ppb += offset * 3 / 10 * MSEC_PER_SEC / PERIOD_MS;
+    freq_ppb = CLAMP(freq_ppb, -TSYNC_MAX_FREQ_PPB, TSYNC_MAX_FREQ_PPB);
+    stats.freq_ppb = (int32_t)freq_ppb;
+    clock_adjust(offset * 7 / 10, (int32_t)freq_ppb);
+
+    if (llabs(offset) <= CONFIG_APP_TSYNC_LOCK_US * NSEC_PER_USEC) {
+        in_bound++;
+    } else {
+        in_bound = 0;
+    }
+    if (stats.lock_ms == 0 && in_bound >= TSYNC_LOCK_COUNT) {
+        stats.lock_ms = (uint32_t)(k_uptime_get() - start_ms);
+        printk("tsync: locked after %u ms\n\r", stats.lock_ms);
+    }
+    if (stats.lock_ms != 0) {
+        residual_add(offset);
+    }
+    if (stats.exchanges % CONFIG_APP_TSYNC_REPORT == 0) {
+        tsync_dump();
+    }
+}
+
+static void tsync_run(void)
+{
+    int64_t release = k_uptime_get();
+    uint8_t seq = 0;
+
+    printk("tsync: slave %u on %s\n\r", CONFIG_APP_TSYNC_NODE, uart_dev->name);
+    start_ms = release;
+
+    while (1) {
+        struct tsync_frame f;
+        uint64_t t1;
+        bool got = false;
+
+        k_msgq_purge(&tsync_rx_q);
+        seq++;
+        t1 = tx_frame(TSYNC_REQ, CONFIG_APP_TSYNC_NODE, seq, 0);
+
+        /* Answers to other slaves, or late ones, are skipped */
+        while (k_msgq_get(&tsync_rx_q, &f, K_MSEC(CONFIG_APP_TSYNC_TIMEOUT_MS)) == 0) {
+            if (f.type == TSYNC_RESP && f.node == CONFIG_APP_TSYNC_NODE && f.seq == seq) {
+                got = true;
+                break;
+            }
+        }
+        if (got) {
+            servo_sample(t1, f.t2, f.t3, f.rx_ns);
+        } else {
+            stats.timeouts++;
+        }
+
+        release += PERIOD_MS;
+        k_sleep(K_TIMEOUT_ABS_MS(release));
+    }
+}
+
+#endif /* CONFIG_APP_TSYNC_MASTER */
+
+void tsync_stats_get(struct tsync_stats *out)
+{
+    *out = stats;
+}
+
+void tsync_dump(void)
+{
+    printk("tsync: %u exchanges, %u rejected, %u timeouts, offset %d ns, "
+           "delay %u ns, freq %d ppb\n\r", stats.exchanges, stats.rejected,
+           stats.timeouts, stats.offset_ns, stats.delay_ns, stats.freq_ppb);
+    if (stats.lock_ms != 0) {
+        printk("tsync: locked after %u ms, residual rms %u ns, max %u ns\n\r",
+               stats.lock_ms, stats.residual_rms_ns, stats.residual_max_ns);
+    }
+}
+
+static void tsync_thread_code(void *argA, void *argB, void *argC)
+{
+    struct uart_config cfg;
+
+    uart_dev = device_get_binding(CONFIG_APP_TSYNC_UART);
+    if (uart_dev == NULL) {
+        printk("Error: tsync UART %s not found\n\r", CONFIG_APP_TSYNC_UART);
+        return;
+    }
+    if (uart_config_get(uart_dev, &cfg) != 0 || cfg.baudrate == 0) {
+        cfg.baudrate = 115200;
+    }
+    char_ns = (uint32_t)(10ULL * NSEC_PER_SEC / cfg.baudrate);
+
+    rx_start();
+    tsync_run();
+}
+
+K_THREAD_DEFINE(tsync_thread, TSYNC_STACK_SIZE, tsync_thread_code, NULL, NULL, NULL,
+                TSYNC_PRIO, 0, 0);
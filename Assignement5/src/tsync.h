@@ -0,0 +1,46 @@
+/*
+ * UART time synchronization
+ *
+ * Two-way time transfer between one master and any number of slaves on a
+ * UART link, in the manner of PTP delay request/response. A slave sends
+ * REQ at t1 (its clock); the master timestamps its arrival (t2) and
+ * answers with RESP carrying t2 and its own transmit time t3, which the
+ * slave receives at t4:
+ *     offset = ((t1 - t2) + (t4 - t3)) / 2    (slave ahead of master)
+ *     delay  = (t4 - t1) - (t3 - t2)          (round trip on the wire)
+ * Slaves discipline their clock (clock_adjust()) with a PI servo that
+ * estimates the frequency error; the time is slewed, never stepped,
+ * except once at acquisition if the offset exceeds APP_TSYNC_STEP_MS.
+ *
+ * Frames: SOF (0xA5), type, node, seq, payload (little endian), CRC-8.
+ *   REQ   slave -> master, no payload
+ *   RESP  master -> slave "node", t2 and t3 as uint64 ns
+ * Transmit timestamps are taken as the SOF byte is written to the idle
+ * UART; receive timestamps as the SOF byte is read, less one character
+ * time. Constant delays common to both directions cancel out.
+ */
+
+#ifndef TSYNC_H
+#define TSYNC_H
+
+#include <zephyr.h>
+
+struct tsync_stats {
+    uint32_t exchanges;         /* Complete REQ/RESP exchanges */
+    uint32_t rejected;          /* Exchanges discarded as delayed outliers */
+    uint32_t timeouts;          /* REQ without RESP */
+    int32_t offset_ns;          /* Last accepted offset */
+    uint32_t delay_ns;          /* Last accepted round-trip delay */
+    int32_t freq_ppb;           /* Estimated frequency error */
+    uint32_t lock_ms;           /* Time to lock (0 while not locked) */
+    uint32_t residual_rms_ns;   /* Offset RMS over the last samples in lock */
+    uint32_t residual_max_ns;   /* Largest |offset| over the same samples */
+};
+
+/* Copy the statistics (slave) */
+void tsync_stats_get(struct tsync_stats *stats);
+
+/* Print the statistics */
+void tsync_dump(void);
+
+#endif /* TSYNC_H */